@@ -1,13 +1,23 @@
 #ifndef APOLLO_H
 #define APOLLO_H
 
+#include <atomic>
 #include <fstream>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "apollo/Config.h"
 
+class TraceWriter;
+class Timeline;
+class ContextFeatures;
+class CompletionQueue;
+
 //TODO(cdw): Convert 'Apollo' into a namespace and convert this into
 //           a 'Runtime' class.
 class Apollo
@@ -26,6 +36,7 @@ class Apollo
         class Region;
         struct RegionContext;
         struct CallbackDataPool;
+        class AsyncContext;
 
         //TODO(cdw): This is serving as an override that is defined by an
         //           environment variable.  Apollo::Region's are able to
@@ -49,18 +60,66 @@ class Apollo
         std::string getCallpathOffset(int walk_distance=2);
         void *callpath_ptr;
 
+        // Region of a C API callsite, keyed by the caller's return address
+        // and named <module>@<offset> when first created there.
+        Apollo::Region *getCallsiteRegion(void *callsite, int num_features, int num_policies,
+                bool &created);
+
         void flushAllRegionMeasurements(int step);
 
+        // Trace of region executions (APOLLO_TRACE_BINARY, APOLLO_TRACE_CSV).
+        std::unique_ptr<TraceWriter> trace_writer;
+        // Internal event timeline (APOLLO_TRACE_TIMELINE), null if disabled.
+        std::unique_ptr<Timeline> timeline;
+        // Execution context features prepended to every region's features
+        // (APOLLO_CONTEXT_FEATURES), null if disabled.
+        std::unique_ptr<ContextFeatures> context_features;
+
+        // Collects contexts finished with Region::complete and polls
+        // isDoneCallback contexts of all regions.  Returns the number of
+        // contexts collected.  Called by the progress thread if
+        // APOLLO_PROGRESS_THREAD is set, else by the application.  Returns
+        // 0 without waiting if not blocking and another thread progresses.
+        int progress(bool blocking = true);
+        // Held by every region call that touches region state, contexts
+        // may be completed and collected on any thread.
+        std::recursive_mutex progress_lock;
+        std::unique_ptr<CompletionQueue> completion_queue;
+        // Period flushes are MPI collectives, those reached off the
+        // application thread (the one that created Apollo) wait there for
+        // its next Region::begin.
+        std::thread::id  application_thread;
+        std::atomic<int> pending_flushes;
+        void flushPending();
+
+        // Buffered policy decision trace (APOLLO_TRACE_POLICY), written to
+        // rank-N-policies.txt when the buffer fills, at flush and at exit.
+        void tracePolicy(const std::string &event);
+        void flushPolicyTrace();
+
     private:
         Apollo();
         //
         void gatherReduceCollectiveTrainingData(int step);
         // Key: region name, value: region raw pointer
         std::map<std::string, Apollo::Region *> regions;
+        std::unordered_map<void *, Apollo::Region *> callsite_regions;
+        std::mutex callsite_lock;
         // Key: region name, value: map key: num_elements, value: policy_index, time_avg
         std::map< std::vector< float >, std::pair< int, double > > best_policies_global;
         // Count total number of region invocations
         unsigned long long region_executions;
+        // Region ids of the execution trace, never reused.
+        std::atomic<int> next_region_id;
+        //
+        std::ofstream policy_trace_file;
+        std::string   policy_trace_buffer;
+        std::mutex    policy_trace_lock;
+        //
+        std::thread       progress_thread;
+        std::atomic<bool> progress_done;
+        std::atomic<bool> progress_requested;
+        int collectCompleted();
 }; //end: Apollo
 
 extern "C" {
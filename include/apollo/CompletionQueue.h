@@ -0,0 +1,29 @@
+#ifndef APOLLO_COMPLETION_QUEUE_H
+#define APOLLO_COMPLETION_QUEUE_H
+
+#include <atomic>
+
+#include "apollo/Apollo.h"
+#include "apollo/Region.h"
+
+// Lock-free multi-producer single-consumer queue of completed region
+// contexts (intrusive, Vyukov), linked through
+// RegionContext::completion_next so pushing never allocates.  Any thread
+// may push, pop must be serialized by the caller (Apollo::progress holds
+// progress_lock).
+class CompletionQueue {
+    public:
+        CompletionQueue();
+
+        void push(Apollo::RegionContext *context);
+        // Returns nullptr when empty or a push is still in flight.
+        Apollo::RegionContext *pop();
+
+    private:
+        Apollo::RegionContext stub;
+        std::atomic<Apollo::RegionContext *> head;
+        Apollo::RegionContext *tail;
+}; //end: CompletionQueue
+
+
+#endif
@@ -10,6 +10,9 @@ class Config {
         static int APOLLO_TRACE_MEASURES;
         static int APOLLO_NUM_POLICIES;
         static int APOLLO_TRACE_POLICY;
+        static int APOLLO_TRACE_POLICY_SAMPLE;
+        static int APOLLO_TRACE_POLICY_ON_CHANGE;
+        static int APOLLO_TRACE_POLICY_STDOUT;
         static int APOLLO_RETRAIN_ENABLE;
         static float APOLLO_RETRAIN_TIME_THRESHOLD;
         static float APOLLO_RETRAIN_REGION_THRESHOLD;
@@ -19,8 +22,40 @@ class Config {
         static int APOLLO_TRACE_BEST_POLICIES;
         static int APOLLO_FLUSH_PERIOD;
         static int APOLLO_TRACE_CSV;
+        static int APOLLO_TRACE_BINARY;
+        static int APOLLO_TRACE_TIMELINE;
+        static int APOLLO_TRACE_OVERHEAD;
+        static float APOLLO_FREEZE_OVERHEAD_RATIO;
+        static int APOLLO_SAMPLE_RATE;
+        static int APOLLO_SAMPLE_TARGET;
+        static float APOLLO_AGGREGATE_TARGET;
+        static std::string APOLLO_TIMER;
+        static std::string APOLLO_METRIC;
+        static std::string APOLLO_CONTEXT_FEATURES;
+        static int APOLLO_PROGRESS_THREAD;
+        static int APOLLO_PARAMETER_CANDIDATES;
+        static int APOLLO_PARAMETER_SAMPLES;
+        static float APOLLO_RACING_CONFIDENCE;
+        static int APOLLO_RACING_MIN_SAMPLES;
+        static int APOLLO_RACING_MAX_SAMPLES;
+        static float APOLLO_BANDIT_ALPHA;
+        static int APOLLO_FACTORIZED_MIN_SAMPLES;
+        static int APOLLO_FACTORIZED_PASSES;
+        static int APOLLO_GUIDED_EXPLORE;
+        static float APOLLO_GUIDED_EXPLORE_THRESHOLD;
+        static float APOLLO_SWITCH_PENALTY;
+        static float APOLLO_SWITCH_HYSTERESIS;
+        static int APOLLO_SWITCH_MEASURE;
+        static int APOLLO_TRACE_SWITCHES;
+        static float APOLLO_OBJECTIVE_QUANTILE;
+        static float APOLLO_SKETCH_ACCURACY;
+        static int APOLLO_MEASURES_MAX_ENTRIES;
+        static float APOLLO_MEASURES_DECAY;
+        static int APOLLO_HEAVY_HITTERS;
+        static int APOLLO_HEAVY_HITTER_THRESHOLD;
         static std::string APOLLO_INIT_MODEL;
         static std::string APOLLO_TRACE_CSV_FOLDER_SUFFIX;
+        static std::string APOLLO_FEATURE_BINNING;
 
     private:
         Config();
@@ -0,0 +1,39 @@
+#ifndef APOLLO_CONTEXT_FEATURES_H
+#define APOLLO_CONTEXT_FEATURES_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Execution context features placed before the application features of
+// every region (APOLLO_CONTEXT_FEATURES), a comma separated list of:
+//   threads         omp_get_max_threads(), the first OMP_NUM_THREADS
+//                   value without OpenMP support, 0 if that is unset
+//   affinity        CPUs in the calling thread's affinity mask
+//   numa            NUMA node of the CPU running the calling thread
+//   oversubscribed  1 if threads exceeds affinity, else 0, always 0
+//                   while threads is unknown
+// Values are cached per thread and recomputed after refresh(), which
+// Apollo calls at every flush.
+class ContextFeatures {
+    public:
+        // Aborts on an unknown feature name.
+        ContextFeatures(const std::string &spec);
+
+        size_t size() const { return kinds.size(); }
+        void   append(std::vector<float> &features);
+        void   refresh() { generation++; }
+
+    private:
+        enum class Kind { Threads, Affinity, Numa, Oversubscribed };
+
+        void compute(std::vector<float> &values) const;
+
+        std::vector<Kind>     kinds;
+        std::atomic<unsigned> generation;
+        // OMP_NUM_THREADS for builds without OpenMP, 0 if unset.
+        int                   env_threads;
+}; //end: ContextFeatures
+
+
+#endif
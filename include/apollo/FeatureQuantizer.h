@@ -0,0 +1,53 @@
+#ifndef APOLLO_FEATURE_QUANTIZER_H
+#define APOLLO_FEATURE_QUANTIZER_H
+
+#include <string>
+#include <vector>
+
+// Maps raw feature values onto bins so that similar inputs share
+// measurements and model keys.  Each bin is represented by a value in the
+// original units (its lower edge), so models trained on binned features
+// stay interpretable.
+//
+// Binning specs (APOLLO_FEATURE_BINNING):
+//   log2            powers of two
+//   linear,<width>  fixed-width buckets
+//   quantile,<n>    n equi-populated bins learned per feature from the
+//                   first n * 32 observed values, log2 until then.  Bins
+//                   are learned only by fit(), called at a flush once
+//                   measures and best policies are cleared, so they never
+//                   hold keys of both binnings.
+class FeatureQuantizer {
+    public:
+        enum class Binning { Log2, Linear, Quantile };
+
+        FeatureQuantizer(const std::string &spec);
+
+        // Quantize the value of the feature at position pos.
+        float apply(size_t pos, float value);
+        // Learn the bins of features with enough samples, true if any
+        // feature changed binning.
+        bool  fit();
+
+        // Persist / restore the mapping next to a model file.
+        void  store(const std::string &filename) const;
+        bool  load(const std::string &filename);
+
+    private:
+        struct Feature {
+            // Quantile bin lower edges, empty until learned.
+            std::vector<float> edges;
+            std::vector<float> samples;
+        };
+
+        void fit(Feature &feature);
+        size_t samplesToFit() const { return static_cast<size_t>( num_bins ) * 32; }
+
+        Binning binning;
+        float   width;
+        int     num_bins;
+        std::vector<Feature> features;
+}; //end: FeatureQuantizer
+
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef APOLLO_HEAVY_HITTERS_H
+#define APOLLO_HEAVY_HITTERS_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+// Space-saving top-k frequency tracker over feature vectors.  Memory is
+// bounded by the capacity regardless of how many distinct vectors are
+// observed.
+class HeavyHitters {
+    public:
+        HeavyHitters(int capacity, int threshold);
+
+        // Count one occurrence of features. Returns true if features are
+        // guaranteed to have been seen at least threshold times.  If a
+        // tracked vector had to make room, it is returned in evicted.
+        bool   observe(const std::vector<float> &features,
+                       std::vector<float> &evicted, bool &has_evicted);
+        size_t size() const { return counters.size(); }
+
+    private:
+        struct Counter {
+            unsigned long long count;
+            // Upper bound on the over-estimation of count.
+            unsigned long long error;
+        };
+
+        size_t capacity;
+        unsigned long long threshold;
+        std::map< std::vector<float>, Counter > counters;
+        // Ordered by count to find the minimum, points to counters' keys.
+        std::set< std::pair< unsigned long long, const std::vector<float> * > > by_count;
+}; //end: HeavyHitters
+
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef APOLLO_METRIC_PROVIDER_H
+#define APOLLO_METRIC_PROVIDER_H
+
+#include <memory>
+#include <string>
+
+// Abstract source of the metric a region optimizes, lower == better.  The
+// reading taken at begin() is kept in the region context and handed back
+// at end() to compute the metric of that execution.
+class MetricProvider {
+    public:
+        MetricProvider(std::string name) : name(name) {};
+        virtual ~MetricProvider() {}
+
+        virtual double start() = 0;
+        virtual double stop(double start) = 0;
+        // Readings are of the calling thread, start and stop must run on
+        // the same thread.
+        virtual bool perThread() const { return false; }
+
+        std::string name;
+
+        // Names: wall, cputime, perf:<event> (see metrics/PerfEvent.h).
+        // Returns nullptr for an unknown name.
+        static std::unique_ptr<MetricProvider> create(const std::string &name);
+}; //end: MetricProvider (abstract class)
+
+
+#endif
@@ -12,6 +12,12 @@ class ModelFactory {
         static std::unique_ptr<PolicyModel> createStatic(int num_policies, int policy_choice );
         static std::unique_ptr<PolicyModel> createRandom(int num_policies);
         static std::unique_ptr<PolicyModel> createRoundRobin(int num_policies);
+        static std::unique_ptr<PolicyModel> createRacing(int num_policies);
+        static std::unique_ptr<PolicyModel> createBandit(int num_policies);
+        static std::unique_ptr<PolicyModel> loadBandit(int num_policies, std::string path);
+        static std::unique_ptr<PolicyModel> createFactorized(const std::vector<int> &knobs);
+        static std::unique_ptr<PolicyModel> createGuided(int num_policies,
+                std::shared_ptr<TimingModel> time_model );
 
         static std::unique_ptr<PolicyModel> loadDecisionTree(int num_policies,
                 std::string path);
@@ -0,0 +1,166 @@
+#ifndef APOLLO_PARALLEL_FOR_H
+#define APOLLO_PARALLEL_FOR_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "apollo/Apollo.h"
+#include "apollo/Region.h"
+
+namespace apollo {
+
+// Tunable loop: Apollo picks how to run [begin, end) from a built-in policy
+// space, using the iteration count as the feature.
+//
+//   policy 0     serial
+//   policy 1     serial, SIMD-hinted
+//   policy 2...  OpenMP, indexed as threads x schedule x chunk over
+//                num_threads, schedules and chunks below.
+//
+// The policy layout is the same with and without OpenMP so every
+// translation unit sees one ParallelFor.  A loop's region only offers the
+// policies the translation unit first running it can execute, the serial
+// ones without OpenMP, so models do not explore identical serial loops;
+// later OpenMP code of the same name runs any policy index it is given
+// serially if it lacks OpenMP.  OpenMP thread counts are fractions of
+// omp_get_max_threads(), so a model keeps its meaning across machines.
+class ParallelFor {
+    public:
+        static constexpr int num_serial    = 2;
+        static constexpr int num_threads   = 3;    // max, max/2, max/4
+        static constexpr int num_schedules = 3;    // static, dynamic, guided
+        static constexpr int num_chunks    = 3;    // default, 64, 1024
+        static constexpr int num_policies  =
+            num_serial + num_threads * num_schedules * num_chunks;
+
+        // The region is owned by Apollo, like any Apollo::Region.  Offers
+        // policies [0, available).
+        ParallelFor(const char *name, int available) :
+            name(name), available(available),
+            region( new Apollo::Region( 1, name, available ) ) {}
+
+        // Starts an execution of iterations iterations, sets its policy.
+        Apollo::RegionContext *begin(double iterations, int &policy) {
+            Apollo::RegionContext *context = region->begin();
+            region->setFeature( context, float( iterations ) );
+            policy = region->getPolicyIndex( context );
+            if( policy < 0 || policy >= available )
+                policy = 0;
+            return context;
+        }
+        void end(Apollo::RegionContext *context) { region->end( context ); }
+
+        const std::string &getName() const { return name; }
+        int getAvailable() const { return available; }
+        Apollo::Region *getRegion() const { return region; }
+
+    private:
+        std::string     name;
+        int             available;
+        Apollo::Region *region;
+}; //end: ParallelFor
+
+// Finds or creates the ParallelFor of a name, offering available policies
+// when created.  Lookups are cached per thread by the name's address and
+// checked against the name, so a string literal keeps the common case off
+// the shared map and a reused buffer is safe.
+inline ParallelFor &getParallelFor(const char *name, int available)
+{
+    thread_local std::unordered_map<const char *, ParallelFor *> cache;
+    auto it = cache.find( name );
+    if( it != cache.end() && it->second->getName() == name )
+        return *it->second;
+
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::unique_ptr<ParallelFor>> loops;
+    std::lock_guard<std::mutex> guard( lock );
+    std::unique_ptr<ParallelFor> &loop = loops[ name ];
+    if( !loop )
+        loop.reset( new ParallelFor( name, available ) );
+    cache[ name ] = loop.get();
+    return *loop;
+}
+
+// The loop bodies depend on _OPENMP, keep them apart by namespace so mixing
+// OpenMP and non-OpenMP translation units links distinct functions.
+#ifdef _OPENMP
+inline namespace openmp {
+constexpr int available_policies = ParallelFor::num_policies;
+#else
+inline namespace serial {
+constexpr int available_policies = ParallelFor::num_serial;
+#endif
+
+// The ParallelFor of a name, offering the policies this code can run.
+inline ParallelFor &getParallelFor(const char *name)
+{
+    return apollo::getParallelFor( name, available_policies );
+}
+
+// Runs [begin, end) under the policy Apollo picks for loop.
+template<typename Index, typename Body>
+inline void parallel_for(ParallelFor &loop, Index begin, Index end, Body &&body)
+{
+    int policy;
+    Apollo::RegionContext *context = loop.begin( end > begin ? double( end - begin ) : 0.0, policy );
+
+    if( policy == 1 ) {
+#if defined(_OPENMP)
+#pragma omp simd
+#elif defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#endif
+        for(Index i = begin; i < end; ++i)
+            body( i );
+    }
+#ifdef _OPENMP
+    else if( policy >= ParallelFor::num_serial ) {
+        int index    = policy - ParallelFor::num_serial;
+        int chunk    = index % ParallelFor::num_chunks;
+        int schedule = ( index / ParallelFor::num_chunks ) % ParallelFor::num_schedules;
+        int threads  = index / ( ParallelFor::num_chunks * ParallelFor::num_schedules );
+
+        static const omp_sched_t kinds[] = { omp_sched_static, omp_sched_dynamic, omp_sched_guided };
+        static const int chunks[] = { 0, 64, 1024 };
+        int nthreads = omp_get_max_threads() >> threads;
+        if( nthreads < 1 )
+            nthreads = 1;
+
+        omp_sched_t saved_kind;
+        int saved_chunk;
+        omp_get_schedule( &saved_kind, &saved_chunk );
+        omp_set_schedule( kinds[ schedule ], chunks[ chunk ] );
+#pragma omp parallel for num_threads(nthreads) schedule(runtime)
+        for(Index i = begin; i < end; ++i)
+            body( i );
+        omp_set_schedule( saved_kind, saved_chunk );
+    }
+#endif
+    else {
+        for(Index i = begin; i < end; ++i)
+            body( i );
+    }
+
+    loop.end( context );
+}
+
+// One-line tuned loop:  apollo::parallel_for( "daxpy", 0, n, [&](int i) { ... } );
+template<typename Index, typename Body>
+inline void parallel_for(const char *name, Index begin, Index end, Body &&body)
+{
+    parallel_for( getParallelFor( name ), begin, end, std::forward<Body>( body ) );
+}
+
+} // end: inline namespace
+
+} // end: namespace apollo
+
+
+#endif
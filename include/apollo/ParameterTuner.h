@@ -0,0 +1,80 @@
+#ifndef APOLLO_PARAMETER_TUNER_H
+#define APOLLO_PARAMETER_TUNER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Searches numeric tuning parameters (tile or chunk sizes, thresholds) per
+// feature vector instead of enumerating each value as a policy.
+//
+// Each feature vector draws num_candidates configurations: the center of
+// the ranges plus a latin hypercube sample.  Successive halving runs every
+// live candidate num_samples times, keeps the faster half by mean metric,
+// doubles num_samples and repeats until one candidate is left.
+class ParameterTuner {
+    public:
+        struct Parameter {
+            std::string name;
+            double min;
+            double max;
+            // Round values to integers.
+            bool   integer;
+            // Sample uniformly in log space, needs min > 0.
+            bool   log_scale;
+        };
+
+        ParameterTuner(int num_candidates, int num_samples);
+
+        // Index of the parameter, reusing a loaded one of the same name.
+        // Names must not contain whitespace.
+        int    add(const Parameter &parameter);
+        size_t size() const { return parameters.size(); }
+        // Some feature vector has not settled on a winner.
+        bool   searching() const;
+
+        // Candidate to run for features, the leader unless explore.
+        int    select(const std::vector<float> &features, bool explore);
+        // Parameter values of a candidate, stable while parameters are not
+        // added.
+        const std::vector<double> &values(const std::vector<float> &features, int candidate);
+        // Leader values of the nearest searched feature vector, for
+        // executions that cannot search.
+        const std::vector<double> &nearest(const std::vector<float> &features);
+        // lower == better
+        void   update(const std::vector<float> &features, int candidate, double metric);
+
+        // Persist / restore the leaders next to a model file, loaded
+        // leaders are final.
+        void   store(const std::string &filename);
+        bool   load(const std::string &filename);
+
+    private:
+        struct Candidate {
+            std::vector<double> values;
+            double total;
+            int    count;
+            bool   alive;
+        };
+
+        struct Search {
+            std::vector<Candidate> candidates;
+            int rung_samples;
+            int next;
+            // Index of the remaining candidate, -1 while searching.
+            int winner;
+        };
+
+        Search &getSearch(const std::vector<float> &features);
+        int     leader(const Search &search) const;
+        void    halve(Search &search);
+        double  scale(const Parameter &parameter, double u) const;
+
+        std::vector<Parameter> parameters;
+        std::map< std::vector<float>, Search > searches;
+        int num_candidates;
+        int num_samples;
+}; //end: ParameterTuner
+
+
+#endif
@@ -15,6 +15,19 @@ class PolicyModel {
         virtual ~PolicyModel() {}
         //
         virtual int      getIndex(std::vector<float> &features) = 0;
+        // Policies of num_rows row-major feature vectors, in row order.
+        virtual void     getIndexBatch(const float *features, int num_rows, int num_features, int *policies) {
+            std::vector<float> row( num_features );
+            for(int i = 0; i < num_rows; i++) {
+                row.assign( features + i * num_features, features + ( i + 1 ) * num_features );
+                policies[i] = getIndex( row );
+            }
+        }
+        // Observe the metric of a completed execution, lower == better.
+        virtual void     update(std::vector<float> &features, int policy, double metric) {}
+        // Models settling on their own winners are kept at flush instead of
+        // being replaced by a DecisionTree trained on best_policies.
+        virtual bool     keepAtFlush() const { return false; }
 
         virtual void    store(const std::string &filename) = 0;
 
@@ -0,0 +1,42 @@
+#ifndef APOLLO_QUANTILE_SKETCH_H
+#define APOLLO_QUANTILE_SKETCH_H
+
+#include <map>
+#include <cstddef>
+
+// Mergeable streaming quantile sketch (DDSketch) with relative accuracy
+// guarantees: any reported quantile q is within a factor of
+// (1 +- relative_accuracy) of the exact value.
+class QuantileSketch {
+    public:
+        QuantileSketch(double relative_accuracy, int max_bins = 2048);
+
+        void   add(double value, double weight = 1.0);
+        void   merge(const QuantileSketch &other);
+        double quantile(double q) const;
+        double count() const { return total; }
+        // Multiply all counts by factor, used for exponential decay.
+        void   scale(double factor);
+        size_t getFootprint() const;
+
+        // Raw access for (un)packing sketches in collectives.
+        const std::map<int, double> &getBins() const { return bins; }
+        double getZeroCount() const { return zero_count; }
+        void   addBin(int index, double weight);
+        void   addZero(double weight);
+
+    private:
+        void collapse();
+
+        double relative_accuracy;
+        double gamma;
+        double log_gamma;
+        int    max_bins;
+        // Values too small to index.
+        double zero_count;
+        double total;
+        std::map<int, double> bins;
+}; //end: QuantileSketch
+
+
+#endif
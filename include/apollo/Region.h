@@ -3,14 +3,24 @@
 #define APOLLO_REGION_H
 
 #include <vector>
+#include <atomic>
 #include <chrono>
+#include <mutex>
 #include <memory>
 #include <map>
+#include <set>
 #include <fstream>
+#include <future>
 
 #include "apollo/Apollo.h"
 #include "apollo/PolicyModel.h"
 #include "apollo/TimingModel.h"
+#include "apollo/QuantileSketch.h"
+#include "apollo/HeavyHitters.h"
+#include "apollo/FeatureQuantizer.h"
+#include "apollo/ParameterTuner.h"
+#include "apollo/Timer.h"
+#include "apollo/MetricProvider.h"
 
 #ifdef ENABLE_MPI
 #include <mpi.h>
@@ -29,7 +39,41 @@ class Apollo::Region {
         typedef struct Measure {
             int       exec_count;
             double    time_total;
-            Measure(int e, double t) : exec_count(e), time_total(t) {}
+            // Streaming (weighted Welford) mean and sum of squared deviations.
+            double    time_mean;
+            double    time_m2;
+            // Sum of (decayed) sample weights, equals exec_count without decay.
+            double    weight;
+            // Region execution index of the last update.
+            int       last_update;
+            // Only allocated for regions optimizing a quantile.
+            std::unique_ptr<QuantileSketch> sketch;
+            Measure() : exec_count(0), time_total(0.0), time_mean(0.0), time_m2(0.0),
+                weight(0.0), last_update(0) {}
+            Measure(int e, double t) :
+                exec_count(e), time_total(t), time_mean( e > 0 ? t / e : 0.0 ), time_m2(0.0),
+                weight(e), last_update(0) {}
+            void add(double t, double w = 1.0) {
+                exec_count++;
+                time_total += w * t;
+                weight += w;
+                double delta = t - time_mean;
+                time_mean += ( w / weight ) * delta;
+                time_m2 += w * delta * ( t - time_mean );
+                if( sketch )
+                    sketch->add( t, w );
+            }
+            // Scale down the weight of all samples seen so far.
+            void decay(double factor) {
+                time_total *= factor;
+                time_m2 *= factor;
+                weight *= factor;
+                if( sketch )
+                    sketch->scale( factor );
+            }
+            double variance() const {
+                return ( weight > 1.0 ) ? ( time_m2 / ( weight - 1.0 ) ) : 0.0;
+            }
         } Measure;
 
         char     name[64];
@@ -48,10 +92,90 @@ class Apollo::Region {
         void end(Apollo::RegionContext *, double);
         int  getPolicyIndex(Apollo::RegionContext *);
         void setFeature(Apollo::RegionContext *, float value);
+        // Policy of an execution that needs no context: the region is
+        // frozen, or the execution is unsampled and its features match the
+        // cached policy's.  Counts the execution and returns true, false if
+        // the caller must begin() as usual.
+        bool getCachedPolicy(const float *features, size_t num_features, int &policy);
+        // Thread-safe end() for asynchronous executions: stamps the end time
+        // and queues the context, Apollo::progress() collects it.
+        void complete(Apollo::RegionContext *);
+        void complete(Apollo::RegionContext *, double metric);
+        // Policies of many contexts of this region in one model pass, e.g.
+        // one per task or patch, and the matching end of all of them.
+        void getPolicyIndexBatch(std::vector<Apollo::RegionContext *> &contexts, std::vector<int> &policies);
+        void endBatch(std::vector<Apollo::RegionContext *> &contexts);
+        void endBatch(std::vector<Apollo::RegionContext *> &contexts, const std::vector<double> &metrics);
+        // Asynchronous execution completed through the returned handle from
+        // any thread, collected at completion without polling.
+        Apollo::AsyncContext beginAsync();
+        Apollo::AsyncContext beginAsync(std::vector<float> features);
+        // Runs fn(policy) with std::async, completing the execution when fn
+        // returns.  The future yields fn's result.
+        template<typename Fn>
+        auto launchAsync(std::vector<float> features, Fn fn) -> std::future<decltype( fn(0) )>;
 
         int idx;
+        // Index of the region in creation order, used by binary traces.
+        int id;
+        // Includes the context features placed before the application's.
         int      num_features;
         int      reduceBestPolicies(int step);
+        // Cost of changing policy between consecutive executions, the
+        // policy changes only when the predicted gain exceeds it.
+        void     setSwitchPenalty(double penalty);
+        // Optimize the q-quantile of the measured time instead of the mean,
+        // q in (0, 1), 0 selects the mean.
+        void     setObjectiveQuantile(double q);
+        // Structured policy space: each policy is a tuple of knob choices,
+        // flattened mixed-radix with the last knob varying fastest.  The
+        // knob sizes must multiply to the region's policy count.  Replaces
+        // a Factorized model so it explores knob by knob.
+        void     setKnobs(const std::vector<int> &sizes);
+        std::vector<int> knobs;
+        // Policy index of the context, decoded into one choice per knob.
+        int      getPolicyTuple(Apollo::RegionContext *, std::vector<int> &choices);
+        double   objective_quantile;
+        double   getObjective(const Apollo::Region::Measure &measure) const;
+        // Per < features, policy > sketches kept across reduction for
+        // merging in collective training.
+        std::map<
+            std::pair< std::vector<float>, int >,
+            std::unique_ptr<QuantileSketch> > policy_sketches;
+        // Policy switches since the last flush.
+        unsigned long long switch_count;
+        // Seconds spent in the region and inside Apollo calls for it
+        // (APOLLO_TRACE_OVERHEAD), setFeature and unsampled executions are
+        // not timed.
+        unsigned long long executions;
+        double   region_time;
+        double   overhead_time;
+        // Mean time per execution lost to non-best policies, measured over
+        // feature vectors with more than one policy measured since the last
+        // flush, -1 until measured.
+        double   tuning_benefit;
+        // Frozen regions run frozen_policy without timing or modeling, see
+        // APOLLO_FREEZE_OVERHEAD_RATIO.
+        bool     frozen;
+        int      frozen_policy;
+        // Time and measure only every Nth execution, the others reuse the
+        // last policy when features match.  APOLLO_SAMPLE_TARGET adapts N
+        // at every flush to that many samples per flush period.
+        void     setSampleRate(int n);
+        int      sample_rate;
+        // Aggregate mode: consecutive executions with the same features run
+        // one policy in batches of batch_size, timed as a whole and
+        // recorded as one averaged measure.  batch_size adapts so a batch
+        // lasts at least target seconds, 0 disables.  Overrides sampling.
+        void     setAggregate(double target);
+        double   aggregate_target;
+        int      batch_size;
+        // Metric measured between begin() and end(), wall time if null.
+        // APOLLO_METRIC sets it for every region.  Per-thread providers
+        // (cputime, perf) cannot follow an execution across threads,
+        // complete() and isDoneCallback executions measure wall time.
+        void     setMetricProvider(std::unique_ptr<MetricProvider> provider);
+        std::unique_ptr<MetricProvider> metric_provider;
         //
         // Application specific callback data pool associated with the region, deleted by apollo.
         Apollo::CallbackDataPool *callback_pool;
@@ -64,36 +188,177 @@ class Apollo::Region {
             std::pair< std::vector<float>, int >,
             std::unique_ptr<Apollo::Region::Measure> > measures;
         //^--Explanation: < features, policy >, value: < time measurement >
+        // APOLLO_MEASURES_MAX_ENTRIES bounds measures only.  best_policies,
+        // trained_features and model state (races, sweeps, parameter
+        // searches) keep an entry per distinct feature vector, bound those
+        // with APOLLO_FEATURE_BINNING.
+        // Only feature vectors frequent enough are measured per policy
+        // (APOLLO_HEAVY_HITTERS).
+        std::unique_ptr<HeavyHitters> heavy_hitters;
+        // Bins feature values on entry (APOLLO_FEATURE_BINNING), stored
+        // next to the model as <model file>.bins.
+        std::unique_ptr<FeatureQuantizer> quantizer;
+        // Numeric tuning parameters in [min, max], searched per feature
+        // vector (see ParameterTuner) and stored next to the model as
+        // <model file>.params.  Declare them before the first execution.
+        // getParameter returns the value to run for the context, in
+        // aggregate mode call it after getPolicyIndex.
+        int      addParameter(const std::string &name, double min, double max,
+                bool integer = false, bool log_scale = false);
+        double   getParameter(Apollo::RegionContext *, int parameter);
+        std::unique_ptr<ParameterTuner> parameters;
+        // Approximate heap bytes held by measures, excluding the other per
+        // feature vector state.
+        size_t   getMeasuresFootprint() const;
 
-        std::unique_ptr<TimingModel> time_model;
+        std::shared_ptr<TimingModel> time_model;
         std::unique_ptr<PolicyModel> model;
+        // Explores feature vectors the trained model has not seen, guided
+        // by time_model (APOLLO_GUIDED_EXPLORE).
+        std::unique_ptr<PolicyModel> explore_model;
+        std::set< std::vector<float> > trained_features;
+        bool explored_unseen;
 
     private:
+        friend class Apollo;
+        // Serializes with collectors and completers on other threads.
+        std::unique_lock<std::recursive_mutex> progressGuard();
         //
         Apollo        *apollo;
         // DEPRECATED wil be removed
         Apollo::RegionContext *current_context;
         //
         std::ofstream trace_file;
+        // Executions are recorded by apollo->trace_writer, see the
+        // constructor.
+        bool trace_binary;
+        // Decisions seen by the APOLLO_TRACE_POLICY sampler.
+        unsigned long long trace_policy_count;
+
+        int    last_policy;
+        double switch_penalty;
+        double measured_switch_penalty;
+        bool predictTime(std::vector<float> &features, int policy, double &time);
+        bool isSwitchProfitable(std::vector<float> &features, int from, int to);
 
         std::vector<Apollo::RegionContext *> pending_contexts;
         void collectPendingContexts();
+        void evictColdMeasures();
+        void loadFeatureBinning(const std::string &model_file);
+        void loadParameters(const std::string &model_file);
         void collectContext(Apollo::RegionContext *, double);
+        bool account_overhead;
+        // Executions whose overhead is timed, unsampled executions are not.
+        unsigned long long timed_executions;
+        // Cleared once a metric other than wall time is reported, overhead
+        // is then not comparable to the tuning benefit.
+        bool wall_time_metric;
+        // Number of context features leading each feature vector.
+        int  context_size;
+        // Reused by every execution of a frozen region.
+        std::unique_ptr<Apollo::RegionContext> frozen_context;
+        void checkFreeze();
+        void countExecution();
+        // same_thread: the execution ends on the thread that began it.
+        double stopMetric(Apollo::RegionContext *, bool same_thread);
+        int    applyPolicy(Apollo::RegionContext *, PolicyModel *, int choice);
+        // Reused by getPolicyIndexBatch.
+        std::vector<float> batch_features;
+        std::vector<int>   batch_rows;
+        std::vector<int>   batch_policies;
+        void measureContext(Apollo::RegionContext *, double);
+        // Aggregate mode state, calls reuse call_context.
+        std::unique_ptr<Apollo::RegionContext> call_context;
+        Apollo::RegionContext *batch_context;
+        int    batch_count;
+        double batch_metric;
+        bool   batch_has_metric;
+        int  getBatchPolicy(Apollo::RegionContext *);
+        void endBatchCall(bool has_metric, double metric);
+        void closeBatch();
+        unsigned long long sample_count;
+        unsigned long long flushed_executions;
+        std::vector<float> cached_features;
+        int                cached_policy;
+        void recordMeasure(Apollo::RegionContext *, double);
+        bool isHeavyHitter(const std::vector<float> &features);
 }; // end: Apollo::Region
 
 struct Apollo::RegionContext
 {
-    std::chrono::steady_clock::time_point exec_time_begin;
-    std::chrono::steady_clock::time_point exec_time_end;
+    Timer::tick_t exec_time_begin;
+    Timer::tick_t exec_time_end;
+    // Reading of the region's metric provider at begin.
+    double metric_begin;
     std::vector<float> features;
     int policy;
     int idx;
+    // Policy differs from the previous execution of the region.
+    bool switched;
+    // Measure weight of a sampled execution, 0 if unsampled.
+    double weight;
+    // Tuning parameter candidate, values empty until getParameter.  Kept
+    // by value, adding a parameter restarts the searches.
+    int    param_candidate;
+    std::vector<double> param_values;
     // Arguments: void *data, bool *returnMetric, double *metric (valid if
     // returnsMetric == true).
     bool (*isDoneCallback)(void *, bool *, double *);
     void *callback_arg;
+    // Completion queue link and payload, see Region::complete.
+    Apollo::Region *region;
+    bool   has_metric;
+    double metric;
+    std::atomic<Apollo::RegionContext *> completion_next;
 }; //end: Apollo::RegionContext
 
+// Move-only handle of an asynchronous region execution.  complete() may
+// be called once from any thread; a handle destroyed while pending
+// completes without a metric.
+class Apollo::AsyncContext {
+    public:
+        AsyncContext() : region(nullptr), context(nullptr) {}
+        AsyncContext(Apollo::Region *region, Apollo::RegionContext *context) :
+            region(region), context(context) {}
+        AsyncContext(AsyncContext &&other) : region(other.region), context(other.context) {
+            other.context = nullptr;
+        }
+        AsyncContext& operator=(AsyncContext &&other);
+        AsyncContext(const AsyncContext&) = delete;
+        AsyncContext& operator=(const AsyncContext&) = delete;
+        ~AsyncContext() {
+            if( context )
+                complete();
+        }
+
+        void setFeature(float value);
+        int  getPolicyIndex();
+        void complete();
+        void complete(double metric);
+        bool pending() const { return context != nullptr; }
+
+    private:
+        Apollo::Region        *region;
+        Apollo::RegionContext *context;
+}; //end: Apollo::AsyncContext
+
+template<typename Fn>
+auto
+Apollo::Region::launchAsync(std::vector<float> features, Fn fn) -> std::future<decltype( fn(0) )>
+{
+    Apollo::AsyncContext handle = beginAsync( std::move( features ) );
+    int policy = handle.getPolicyIndex();
+    return std::async( std::launch::async,
+            [fn, policy](Apollo::AsyncContext handle) mutable {
+                // Completes as soon as fn returns, before the future is ready.
+                struct Done {
+                    Apollo::AsyncContext &handle;
+                    ~Done() { handle.complete(); }
+                } done{ handle };
+                return fn( policy );
+            }, std::move( handle ) );
+}
+
 struct Apollo::CallbackDataPool {
     virtual ~CallbackDataPool() = default;
     virtual void put(void *) = 0;
@@ -0,0 +1,97 @@
+#ifndef APOLLO_TIMELINE_H
+#define APOLLO_TIMELINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Event timeline of Apollo internal activity (APOLLO_TRACE_TIMELINE),
+// written as Chrome trace-event JSON to
+//   apollo-timeline-rank-<rank>.json
+// which loads in chrome://tracing and Perfetto.  Each thread records into
+// its own buffer, written to the file every flush_events events, when the
+// thread exits, for reuse by the next thread, and on destruction, so
+// memory stays bounded on long runs; callers hold a Timeline pointer that is null when
+// disabled so the off path is a single branch.  Only one timeline may
+// exist at a time.
+class Timeline {
+    public:
+        Timeline(int rank);
+        ~Timeline();
+
+        void begin(const char *name);
+        void begin(const char *name, const char *key, const std::string &value);
+        void begin(const char *name, const char *key, long long value);
+        void end(const char *name);
+        void instant(const char *name, const char *key, const std::string &value);
+
+        // Records a begin/end pair around the enclosing scope.
+        class Scope {
+            public:
+                Scope(Timeline *timeline, const char *name) :
+                    timeline(timeline), name(name) {
+                    if( timeline ) timeline->begin( name );
+                }
+                Scope(Timeline *timeline, const char *name, const char *key, const std::string &value) :
+                    timeline(timeline), name(name) {
+                    if( timeline ) timeline->begin( name, key, value );
+                }
+                Scope(Timeline *timeline, const char *name, const char *key, long long value) :
+                    timeline(timeline), name(name) {
+                    if( timeline ) timeline->begin( name, key, value );
+                }
+                ~Scope() {
+                    if( timeline ) timeline->end( name );
+                }
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+            private:
+                Timeline   *timeline;
+                const char *name;
+        };
+
+    private:
+        struct Event {
+            char        phase;
+            const char *name;
+            int64_t     ts;   // microseconds since the timeline started
+            const char *key;  // optional argument, nullptr if none
+            std::string value;
+            bool        quoted;
+        };
+
+        struct Buffer {
+            int tid;
+            std::vector<Event> events;
+        };
+
+        static const size_t flush_events = 4096;
+
+        // Thread-local hold on a buffer of the timeline with timeline_id.
+        struct BufferOwner;
+        static void releaseBuffer(uint64_t timeline_id, Buffer *buffer);
+
+        Buffer *getBuffer();
+        void    record(char phase, const char *name, const char *key, std::string value, bool quoted);
+        void    flush(Buffer &buffer);
+
+        int rank;
+        // Distinguishes a timeline from earlier ones at the same address.
+        uint64_t id;
+        std::chrono::steady_clock::time_point origin;
+
+        std::mutex    file_lock;
+        std::ofstream fout;
+
+        std::mutex buffers_lock;
+        std::vector< std::unique_ptr<Buffer> > buffers;
+        std::vector< Buffer * > free_buffers;
+        int next_tid;
+}; //end: Timeline
+
+
+#endif
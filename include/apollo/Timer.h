@@ -0,0 +1,64 @@
+#ifndef APOLLO_TIMER_H
+#define APOLLO_TIMER_H
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define APOLLO_HAVE_TSC 1
+#endif
+
+// Pluggable timestamp source for region timing, selected once at init by
+// APOLLO_TIMER:
+//   steady         std::chrono::steady_clock (default)
+//   tsc            invariant TSC (rdtscp), calibrated against
+//                  CLOCK_MONOTONIC_RAW at init, falls back to monotonic_raw
+//                  when the CPU has no invariant TSC
+//   monotonic_raw  clock_gettime(CLOCK_MONOTONIC_RAW)
+// Timestamps are opaque ticks, only differences converted by seconds()
+// are meaningful.
+class Timer {
+    public:
+        typedef uint64_t tick_t;
+
+        enum Backend { STEADY, TSC, MONOTONIC_RAW };
+
+        // Returns false and keeps the current backend if name is unknown.
+        static bool init(const std::string &name);
+        static const char *name();
+
+        static inline tick_t now() {
+            switch( backend ) {
+#ifdef APOLLO_HAVE_TSC
+                case TSC: {
+                    unsigned int aux;
+                    return __rdtscp( &aux );
+                }
+#endif
+                case MONOTONIC_RAW: {
+                    struct timespec ts;
+                    clock_gettime( CLOCK_MONOTONIC_RAW, &ts );
+                    return static_cast<tick_t>( ts.tv_sec ) * 1000000000ull + ts.tv_nsec;
+                }
+                default:
+                    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now().time_since_epoch() ).count();
+            }
+        }
+
+        static inline double seconds(tick_t ticks) {
+            return ticks * seconds_per_tick;
+        }
+
+    private:
+        static Backend backend;
+        static double  seconds_per_tick;
+        static double  calibrateTSC();
+}; //end: Timer
+
+
+#endif
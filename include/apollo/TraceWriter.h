@@ -0,0 +1,86 @@
+#ifndef APOLLO_TRACE_WRITER_H
+#define APOLLO_TRACE_WRITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define APOLLO_TRACE_MAX_FEATURES 8
+
+// Fixed-size binary trace record, one per collected region execution.
+struct TraceRecord {
+    int32_t rank;
+    int32_t region_id;
+    int64_t idx;
+    int32_t policy;
+    int32_t num_features;
+    float   features[ APOLLO_TRACE_MAX_FEATURES ];
+    double  time;
+};
+static_assert( sizeof(TraceRecord) == 64, "TraceRecord layout must match the converter" );
+
+// Asynchronous trace writer (APOLLO_TRACE_BINARY, APOLLO_TRACE_CSV).  Each
+// application thread appends records to its own single-producer ring
+// buffer without locking, returned for reuse when the thread exits, a
+// background thread drains all rings into
+//   <folder>/trace-rank-<rank>.bin
+// On destruction the binary trace is converted to the per region
+// APOLLO_TRACE_CSV files if csv is set, and kept with its region table in
+// <folder>/trace-rank-<rank>.meta if binary is set.
+// src/python/analysis/trace2csv.py converts a kept binary trace offline.
+// Regions wider than APOLLO_TRACE_MAX_FEATURES are not traced, addRegion
+// returns false.  Only one writer may exist at a time.
+class TraceWriter {
+    public:
+        TraceWriter(const std::string &folder, int rank, const std::string &training,
+                bool binary, bool csv);
+        ~TraceWriter();
+
+        bool addRegion(int region_id, const std::string &name, int num_features);
+        void write(const TraceRecord &record);
+
+    private:
+        static const size_t ring_size = 4096;
+
+        struct Ring {
+            std::atomic<size_t> head;
+            std::atomic<size_t> tail;
+            TraceRecord records[ ring_size ];
+            Ring() : head(0), tail(0) {}
+        };
+
+        // Thread-local hold on a ring of the writer with writer_id.
+        struct RingOwner;
+        static void releaseRing(uint64_t writer_id, Ring *ring);
+
+        Ring  *getRing();
+        size_t drain();
+        void   run();
+        void   writeCSV();
+        std::string getBinaryName() const;
+
+        std::string folder;
+        int         rank;
+        std::string training;
+        bool        binary;
+        bool        csv;
+        FILE       *fout;
+        // Distinguishes a writer from earlier ones at the same address.
+        uint64_t    id;
+
+        std::mutex rings_lock;
+        std::vector< std::unique_ptr<Ring> > rings;
+        std::vector< Ring * > free_rings;
+        std::vector< std::pair<int, std::pair<std::string, int> > > regions;
+
+        std::atomic<bool> done;
+        std::thread writer;
+}; //end: TraceWriter
+
+
+#endif
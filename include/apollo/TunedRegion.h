@@ -0,0 +1,118 @@
+#ifndef APOLLO_TUNED_REGION_H
+#define APOLLO_TUNED_REGION_H
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "apollo/Apollo.h"
+#include "apollo/Region.h"
+
+namespace apollo {
+
+// Header-only typed front end of Apollo::Region.  The feature count and the
+// policy set are fixed at compile time, the policy index dispatches through
+// a jump table of the Policies callables and begin/end are scoped:
+//
+//   auto tuned = apollo::makeTunedRegion<1>( "copy",
+//           [](float *a, size_t n) { ... },     // policy 0
+//           [](float *a, size_t n) { ... } );   // policy 1
+//   tuned( { float(n) }, a, n );
+//
+// With APOLLO_SAMPLE_RATE > 1 unsampled calls, and calls of a frozen
+// region, take the cached policy without a region context, so the common
+// case is one locked lookup plus a direct call.
+template<size_t NumFeatures, typename... Policies>
+class TunedRegion {
+    public:
+        static constexpr size_t num_policies = sizeof...(Policies);
+        static_assert( num_policies > 0, "TunedRegion needs at least one policy" );
+
+        typedef std::array<float, NumFeatures> Features;
+
+        // The region is owned by Apollo, like any Apollo::Region.
+        TunedRegion(const char *name, Policies... policies) :
+            region( new Apollo::Region( NumFeatures, name, num_policies ) ),
+            policies( std::move( policies )... ) {}
+
+        // One scoped execution: begin on construction, end on destruction.
+        class Execution {
+            public:
+                Execution(TunedRegion &tuned, const Features &features) :
+                    tuned(tuned), context(nullptr) {
+                    int index;
+                    if( !tuned.region->getCachedPolicy( features.data(), NumFeatures, index ) ) {
+                        context = tuned.region->begin();
+                        context->features.reserve( context->features.size() + NumFeatures );
+                        for(auto f : features)
+                            tuned.region->setFeature( context, f );
+                        index = tuned.region->getPolicyIndex( context );
+                    }
+                    // A global APOLLO_NUM_POLICIES override may exceed the
+                    // compile-time policy count.
+                    policy = ( index >= 0 && static_cast<size_t>( index ) < num_policies ) ? index : 0;
+                }
+                ~Execution() {
+                    if( context )
+                        tuned.region->end( context );
+                }
+                Execution(const Execution&) = delete;
+                Execution& operator=(const Execution&) = delete;
+
+                size_t getPolicy() const { return policy; }
+
+                template<typename... Args>
+                decltype(auto) run(Args&&... args) {
+                    return tuned.dispatch( policy, std::index_sequence_for<Policies...>(),
+                            std::forward<Args>( args )... );
+                }
+
+            private:
+                TunedRegion           &tuned;
+                // Null for a cached policy.
+                Apollo::RegionContext *context;
+                size_t                 policy;
+        };
+
+        template<typename... Args>
+        decltype(auto) operator()(const Features &features, Args&&... args) {
+            Execution execution( *this, features );
+            return execution.run( std::forward<Args>( args )... );
+        }
+
+        Apollo::Region *getRegion() const { return region; }
+
+    private:
+        template<typename... Args>
+        using Result = typename std::common_type<
+            decltype( std::declval<Policies &>()( std::declval<Args>()... ) )... >::type;
+
+        template<size_t I, typename... Args>
+        static Result<Args...> invoke(std::tuple<Policies...> &policies, Args&&... args) {
+            return std::get<I>( policies )( std::forward<Args>( args )... );
+        }
+
+        template<size_t... I, typename... Args>
+        Result<Args...> dispatch(size_t policy, std::index_sequence<I...>, Args&&... args) {
+            typedef Result<Args...> (*Invoker)(std::tuple<Policies...> &, Args&&...);
+            static constexpr Invoker table[] = { &invoke<I, Args...>... };
+            return table[ policy ]( policies, std::forward<Args>( args )... );
+        }
+
+        Apollo::Region          *region;
+        std::tuple<Policies...>  policies;
+}; //end: TunedRegion
+
+template<size_t NumFeatures, typename... Policies>
+TunedRegion<NumFeatures, Policies...>
+makeTunedRegion(const char *name, Policies... policies)
+{
+    return TunedRegion<NumFeatures, Policies...>( name, std::move( policies )... );
+}
+
+} // end: namespace apollo
+
+
+#endif
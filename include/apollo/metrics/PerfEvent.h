@@ -0,0 +1,36 @@
+#ifndef APOLLO_METRICS_PERF_EVENT_H
+#define APOLLO_METRICS_PERF_EVENT_H
+
+#include <cstdint>
+#include <string>
+
+#include "apollo/MetricProvider.h"
+
+// Linux perf_event_open counter of the calling thread.  Events:
+//   hardware: cycles, instructions, cache-references, cache-misses,
+//             branch-misses
+//   software: task-clock, page-faults, context-switches
+// A hardware event that cannot be opened (no PMU, VM, perf_event_paranoid)
+// falls back to task-clock with a warning.  Each thread opens its own
+// counter on first use, begin and end must run on the same thread.
+class PerfEvent : public MetricProvider {
+    public:
+        // Returns false for an unknown event name.
+        static bool lookup(const std::string &event, uint32_t &type, uint64_t &config);
+
+        PerfEvent(uint32_t type, uint64_t config, const std::string &event);
+        ~PerfEvent();
+
+        double start();
+        double stop(double start);
+        bool   perThread() const { return true; }
+
+    private:
+        int getFd();
+
+        uint32_t type;
+        uint64_t config;
+}; //end: PerfEvent
+
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef APOLLO_METRICS_THREAD_CPU_TIME_H
+#define APOLLO_METRICS_THREAD_CPU_TIME_H
+
+#include "apollo/MetricProvider.h"
+
+// Seconds of CPU time of the calling thread (CLOCK_THREAD_CPUTIME_ID), not
+// inflated by preemption on shared nodes.  Begin and end must run on the
+// same thread.
+class ThreadCPUTime : public MetricProvider {
+    public:
+        ThreadCPUTime();
+        ~ThreadCPUTime();
+
+        double start();
+        double stop(double start);
+        bool   perThread() const { return true; }
+}; //end: ThreadCPUTime
+
+
+#endif
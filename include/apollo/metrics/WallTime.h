@@ -0,0 +1,18 @@
+#ifndef APOLLO_METRICS_WALL_TIME_H
+#define APOLLO_METRICS_WALL_TIME_H
+
+#include "apollo/MetricProvider.h"
+
+// Seconds of wall time from the APOLLO_TIMER backend.  Regions without a
+// provider measure the same without the virtual calls.
+class WallTime : public MetricProvider {
+    public:
+        WallTime();
+        ~WallTime();
+
+        double start();
+        double stop(double start);
+}; //end: WallTime
+
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef APOLLO_MODELS_BANDIT_H
+#define APOLLO_MODELS_BANDIT_H
+
+#include <string>
+#include <vector>
+
+#include "apollo/PolicyModel.h"
+
+// Disjoint LinUCB contextual bandit: one ridge regression of the reward
+// -log(1 + metric / scale) per policy, with scale fixed to the first
+// metric, learned online from every collected measurement, choosing the
+// policy with the highest upper confidence bound for the given features.
+// The bound is the full x^T A_inv x, O(policies x features^2) per query
+// with few features.  Never retrained at flush, store keeps what it
+// learned and the path constructor resumes from it.
+class Bandit : public PolicyModel {
+    public:
+        Bandit(int num_policies, float alpha);
+        Bandit(int num_policies, float alpha, const std::string &path);
+        ~Bandit();
+
+        int  getIndex(std::vector<float> &features);
+        void update(std::vector<float> &features, int policy, double metric);
+        void store(const std::string &filename);
+        bool keepAtFlush() const { return true; }
+
+    private:
+        struct Arm {
+            // Inverse of the d x d design matrix, row-major.
+            std::vector<double> A_inv;
+            std::vector<double> b;
+            std::vector<double> theta;
+        };
+
+        void init(size_t num_features);
+        void context(const std::vector<float> &features);
+
+        std::vector<Arm> arms;
+        // Bias term followed by the transformed features, size dim.
+        std::vector<double> x;
+        std::vector<double> tmp;
+        size_t dim;
+        float alpha;
+        // Fixed at the first update so every reward in b shares one scale,
+        // rewards stay <= 0 so untried policies remain optimistic.
+        double metric_scale;
+
+}; //end: Bandit (class)
+
+
+#endif
@@ -20,6 +20,7 @@ class DecisionTree : public PolicyModel {
 
         int  getIndex(void);
         int  getIndex(std::vector<float> &features);
+        void getIndexBatch(const float *features, int num_rows, int num_features, int *policies);
         void store(const std::string &filename);
         void load(const std::string &filename);
 
@@ -0,0 +1,57 @@
+#ifndef APOLLO_MODELS_FACTORIZED_H
+#define APOLLO_MODELS_FACTORIZED_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "apollo/PolicyModel.h"
+#include "apollo/Region.h"
+
+// Explores a structured policy space one knob at a time per feature
+// vector: cycles the values of a knob with the others at their best so
+// far, keeps the fastest after min_samples each and moves to the next
+// knob.  A pass over all knobs costs the sum of the knob sizes, not their
+// product.  Policies are flattened mixed-radix, the last knob fastest.
+// Kept at flush while any sweep is open, the first flush after all settle
+// replaces it by a DecisionTree on best_policies, which also covers unseen
+// feature vectors.  store writes every sweep's best tuple.
+class Factorized : public PolicyModel {
+    public:
+        Factorized(const std::vector<int> &knobs, int min_samples, int passes);
+        ~Factorized();
+
+        int  getIndex(std::vector<float> &features);
+        void update(std::vector<float> &features, int policy, double metric);
+        void store(const std::string &filename);
+        bool keepAtFlush() const { return open_sweeps > 0; }
+
+    private:
+        struct Sweep {
+            std::vector<int> best;
+            // Measures of the values of the knob being explored.
+            std::vector<Apollo::Region::Measure> stats;
+            int  knob;
+            int  next;
+            int  pass;
+            bool done;
+        };
+
+        Sweep &getSweep(const std::vector<float> &features);
+        void   nextKnob(Sweep &sweep, int from);
+        // nextKnob, closing the sweep when no knob is left.
+        void   settle(Sweep &sweep, int from);
+        int    encode(const std::vector<int> &choices) const;
+        void   decode(int policy, std::vector<int> &choices) const;
+
+        std::map< std::vector<float>, Sweep > sweeps;
+        std::vector<int> knobs;
+        std::vector<int> choices;
+        int min_samples;
+        int passes;
+        int open_sweeps;
+
+}; //end: Factorized (class)
+
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef APOLLO_MODELS_GUIDED_H
+#define APOLLO_MODELS_GUIDED_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "apollo/PolicyModel.h"
+#include "apollo/TimingModel.h"
+
+// Round-robin exploration restricted, per feature vector, to the policies
+// whose predicted time is within a threshold factor of the best predicted
+// policy.
+class Guided : public PolicyModel {
+    public:
+        Guided(int num_policies, std::shared_ptr<TimingModel> time_model, float threshold);
+        ~Guided();
+
+        int  getIndex(std::vector<float> &features);
+        void store(const std::string &filename) {};
+
+    private:
+        struct Candidates {
+            std::vector<int> policies;
+            size_t next;
+        };
+
+        Candidates &getCandidates(const std::vector<float> &features);
+
+        std::shared_ptr<TimingModel> time_model;
+        float threshold;
+        std::map< std::vector<float>, Candidates > candidates;
+
+}; //end: Guided (class)
+
+
+#endif
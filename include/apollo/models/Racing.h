@@ -0,0 +1,47 @@
+#ifndef APOLLO_MODELS_RACING_H
+#define APOLLO_MODELS_RACING_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "apollo/PolicyModel.h"
+#include "apollo/Region.h"
+
+// Explores policies round-robin per feature vector, dropping a policy once
+// its confidence interval lies entirely above the current leader's and
+// settling on the leader when it is the only policy left, or once every
+// surviving policy has max_samples samples (0 races until separation) so
+// ties close too.  Training while any race is open, kept at flush since
+// the winners are final.
+class Racing : public PolicyModel {
+    public:
+        Racing(int num_policies, float confidence, int min_samples, int max_samples);
+        ~Racing();
+
+        int  getIndex(std::vector<float> &features);
+        void update(std::vector<float> &features, int policy, double metric);
+        void store(const std::string &filename) {};
+        bool keepAtFlush() const { return true; }
+
+    private:
+        struct Race {
+            std::vector<Apollo::Region::Measure> stats;
+            std::vector<bool> alive;
+            int next;
+            int winner;
+        };
+
+        Race &getRace(const std::vector<float> &features);
+        void  eliminate(Race &race);
+
+        std::map< std::vector<float>, Race > races;
+        float confidence;
+        int   min_samples;
+        int   max_samples;
+        int   open_races;
+
+}; //end: Racing (class)
+
+
+#endif
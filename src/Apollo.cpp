@@ -43,13 +43,21 @@
 #include <typeinfo>
 #include <algorithm>
 #include <iomanip>
+#include <limits>
 
 #include <execinfo.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
 
 #include "apollo/Apollo.h"
 #include "apollo/Logging.h"
 #include "apollo/Region.h"
 #include "apollo/ModelFactory.h"
+#include "apollo/TraceWriter.h"
+#include "apollo/Timeline.h"
+#include "apollo/Timer.h"
+#include "apollo/ContextFeatures.h"
+#include "apollo/CompletionQueue.h"
 
 //
 #include "util/Debug.h"
@@ -140,9 +148,44 @@ Apollo::getCallpathOffset(int walk_distance)
   return region_id;
 }
 
+Apollo::Region *
+Apollo::getCallsiteRegion(void *callsite, int num_features, int num_policies, bool &created)
+{
+    std::lock_guard<std::mutex> guard( callsite_lock );
+    created = false;
+    auto iter = callsite_regions.find( callsite );
+    if( iter != callsite_regions.end() )
+        return iter->second;
+
+    // Named <module>@<offset>, the callsite's offset from the module base,
+    // so names stay stable under ASLR.  getCallpathOffset ids carry the
+    // absolute address and do not match these.
+    std::string region_id;
+    Dl_info info;
+    if( dladdr( callsite, &info ) && info.dli_fname ) {
+        std::string module_name = info.dli_fname;
+        module_name = module_name.substr( module_name.find_last_of( "/\\" ) + 1 );
+        std::stringstream addr;
+        addr << "0x" << std::hex << ( reinterpret_cast<uintptr_t>( callsite )
+                - reinterpret_cast<uintptr_t>( info.dli_fbase ) );
+        region_id = module_name + "@" + addr.str();
+    }
+    else {
+        std::stringstream addr;
+        addr << callsite;
+        region_id = "unknown@" + addr.str();
+    }
+
+    Apollo::Region *region = new Apollo::Region( num_features, region_id.c_str(), num_policies );
+    callsite_regions.insert( { callsite, region } );
+    created = true;
+    return region;
+}
+
 Apollo::Apollo()
 {
     region_executions = 0;
+    next_region_id = 0;
 
     // Initialize config with defaults
     Config::APOLLO_INIT_MODEL          = apolloUtils::safeGetEnv( "APOLLO_INIT_MODEL", "Static,0" );
@@ -154,6 +197,9 @@ Apollo::Apollo()
     Config::APOLLO_NUM_POLICIES        = std::stoi( apolloUtils::safeGetEnv( "APOLLO_NUM_POLICIES", "0" ) );
     Config::APOLLO_FLUSH_PERIOD       = std::stoi( apolloUtils::safeGetEnv( "APOLLO_FLUSH_PERIOD", "0" ) );
     Config::APOLLO_TRACE_POLICY        = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_POLICY", "0" ) );
+    Config::APOLLO_TRACE_POLICY_SAMPLE = std::max( 1, std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_POLICY_SAMPLE", "1" ) ) );
+    Config::APOLLO_TRACE_POLICY_ON_CHANGE = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_POLICY_ON_CHANGE", "0" ) );
+    Config::APOLLO_TRACE_POLICY_STDOUT = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_POLICY_STDOUT", "0" ) );
     Config::APOLLO_STORE_MODELS        = std::stoi( apolloUtils::safeGetEnv( "APOLLO_STORE_MODELS", "0" ) );
     Config::APOLLO_TRACE_RETRAIN       = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_RETRAIN", "0" ) );
     Config::APOLLO_TRACE_ALLGATHER     = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_ALLGATHER", "0" ) );
@@ -163,6 +209,38 @@ Apollo::Apollo()
     Config::APOLLO_RETRAIN_REGION_THRESHOLD = std::stof( apolloUtils::safeGetEnv( "APOLLO_RETRAIN_REGION_THRESHOLD", "0.5" ) );
     Config::APOLLO_TRACE_CSV = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_CSV", "0" ) );
     Config::APOLLO_TRACE_CSV_FOLDER_SUFFIX = apolloUtils::safeGetEnv( "APOLLO_TRACE_CSV_FOLDER_SUFFIX", "" );
+    Config::APOLLO_TRACE_BINARY = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_BINARY", "0" ) );
+    Config::APOLLO_TRACE_TIMELINE = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_TIMELINE", "0" ) );
+    Config::APOLLO_TRACE_OVERHEAD = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_OVERHEAD", "0" ) );
+    Config::APOLLO_FREEZE_OVERHEAD_RATIO = std::stof( apolloUtils::safeGetEnv( "APOLLO_FREEZE_OVERHEAD_RATIO", "0" ) );
+    Config::APOLLO_SAMPLE_RATE = std::max( 1, std::stoi( apolloUtils::safeGetEnv( "APOLLO_SAMPLE_RATE", "1" ) ) );
+    Config::APOLLO_SAMPLE_TARGET = std::stoi( apolloUtils::safeGetEnv( "APOLLO_SAMPLE_TARGET", "0" ) );
+    Config::APOLLO_AGGREGATE_TARGET = std::stof( apolloUtils::safeGetEnv( "APOLLO_AGGREGATE_TARGET", "0" ) );
+    Config::APOLLO_TIMER = apolloUtils::safeGetEnv( "APOLLO_TIMER", "steady" );
+    Config::APOLLO_METRIC = apolloUtils::safeGetEnv( "APOLLO_METRIC", "wall" );
+    Config::APOLLO_CONTEXT_FEATURES = apolloUtils::safeGetEnv( "APOLLO_CONTEXT_FEATURES", "" );
+    Config::APOLLO_PROGRESS_THREAD = std::stoi( apolloUtils::safeGetEnv( "APOLLO_PROGRESS_THREAD", "0" ) );
+    Config::APOLLO_PARAMETER_CANDIDATES = std::max( 1, std::stoi( apolloUtils::safeGetEnv( "APOLLO_PARAMETER_CANDIDATES", "16" ) ) );
+    Config::APOLLO_PARAMETER_SAMPLES = std::max( 1, std::stoi( apolloUtils::safeGetEnv( "APOLLO_PARAMETER_SAMPLES", "1" ) ) );
+    Config::APOLLO_RACING_CONFIDENCE   = std::stof( apolloUtils::safeGetEnv( "APOLLO_RACING_CONFIDENCE", "1.96" ) );
+    Config::APOLLO_RACING_MIN_SAMPLES  = std::stoi( apolloUtils::safeGetEnv( "APOLLO_RACING_MIN_SAMPLES", "3" ) );
+    Config::APOLLO_RACING_MAX_SAMPLES  = std::stoi( apolloUtils::safeGetEnv( "APOLLO_RACING_MAX_SAMPLES", "100" ) );
+    Config::APOLLO_BANDIT_ALPHA        = std::stof( apolloUtils::safeGetEnv( "APOLLO_BANDIT_ALPHA", "1.0" ) );
+    Config::APOLLO_FACTORIZED_MIN_SAMPLES = std::stoi( apolloUtils::safeGetEnv( "APOLLO_FACTORIZED_MIN_SAMPLES", "3" ) );
+    Config::APOLLO_FACTORIZED_PASSES   = std::stoi( apolloUtils::safeGetEnv( "APOLLO_FACTORIZED_PASSES", "1" ) );
+    Config::APOLLO_GUIDED_EXPLORE      = std::stoi( apolloUtils::safeGetEnv( "APOLLO_GUIDED_EXPLORE", "0" ) );
+    Config::APOLLO_GUIDED_EXPLORE_THRESHOLD = std::stof( apolloUtils::safeGetEnv( "APOLLO_GUIDED_EXPLORE_THRESHOLD", "2.0" ) );
+    Config::APOLLO_SWITCH_PENALTY      = std::stof( apolloUtils::safeGetEnv( "APOLLO_SWITCH_PENALTY", "0.0" ) );
+    Config::APOLLO_SWITCH_HYSTERESIS   = std::stof( apolloUtils::safeGetEnv( "APOLLO_SWITCH_HYSTERESIS", "0.0" ) );
+    Config::APOLLO_SWITCH_MEASURE      = std::stoi( apolloUtils::safeGetEnv( "APOLLO_SWITCH_MEASURE", "0" ) );
+    Config::APOLLO_TRACE_SWITCHES      = std::stoi( apolloUtils::safeGetEnv( "APOLLO_TRACE_SWITCHES", "0" ) );
+    Config::APOLLO_OBJECTIVE_QUANTILE  = std::stof( apolloUtils::safeGetEnv( "APOLLO_OBJECTIVE_QUANTILE", "0.0" ) );
+    Config::APOLLO_SKETCH_ACCURACY     = std::stof( apolloUtils::safeGetEnv( "APOLLO_SKETCH_ACCURACY", "0.01" ) );
+    Config::APOLLO_MEASURES_MAX_ENTRIES = std::stoi( apolloUtils::safeGetEnv( "APOLLO_MEASURES_MAX_ENTRIES", "0" ) );
+    Config::APOLLO_MEASURES_DECAY      = std::stof( apolloUtils::safeGetEnv( "APOLLO_MEASURES_DECAY", "0" ) );
+    Config::APOLLO_HEAVY_HITTERS       = std::stoi( apolloUtils::safeGetEnv( "APOLLO_HEAVY_HITTERS", "0" ) );
+    Config::APOLLO_HEAVY_HITTER_THRESHOLD = std::stoi( apolloUtils::safeGetEnv( "APOLLO_HEAVY_HITTER_THRESHOLD", "2" ) );
+    Config::APOLLO_FEATURE_BINNING     = apolloUtils::safeGetEnv( "APOLLO_FEATURE_BINNING", "" );
 
     //std::cout << "init model " << Config::APOLLO_INIT_MODEL << std::endl;
     //std::cout << "collective " << Config::APOLLO_COLLECTIVE_TRAINING << std::endl;
@@ -170,6 +248,12 @@ Apollo::Apollo()
     //std::cout << "global "     << Config::APOLLO_SINGLE_MODEL << std::endl;
     //std::cout << "region "     << Config::APOLLO_REGION_MODEL << std::endl;
 
+    if( !Timer::init( Config::APOLLO_TIMER ) ) {
+        std::cerr << "Invalid APOLLO_TIMER " << Config::APOLLO_TIMER \
+            << ", expected steady, tsc or monotonic_raw" << std::endl;
+        abort();
+    }
+
     if ( Config::APOLLO_COLLECTIVE_TRAINING ) {
 #ifndef ENABLE_MPI
         std::cerr << "Collective training requires MPI support to be enabled" << std::endl;
@@ -207,6 +291,47 @@ Apollo::Apollo()
     mpiRank = 0;
 #endif //ENABLE_MPI
 
+    if( Config::APOLLO_TRACE_BINARY || Config::APOLLO_TRACE_CSV ) {
+        std::string folder( "./trace" + Config::APOLLO_TRACE_CSV_FOLDER_SUFFIX );
+        int ret = mkdir( folder.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH );
+        if (ret != 0 && errno != EEXIST) {
+            perror("TRACE mkdir");
+            abort();
+        }
+        trace_writer = std::make_unique<TraceWriter>( folder, mpiRank, Config::APOLLO_INIT_MODEL,
+                Config::APOLLO_TRACE_BINARY, Config::APOLLO_TRACE_CSV );
+    }
+
+    if( Config::APOLLO_TRACE_TIMELINE )
+        timeline = std::make_unique<Timeline>( mpiRank );
+
+    if( !Config::APOLLO_CONTEXT_FEATURES.empty() )
+        context_features = std::make_unique<ContextFeatures>( Config::APOLLO_CONTEXT_FEATURES );
+
+    completion_queue = std::make_unique<CompletionQueue>();
+    application_thread = std::this_thread::get_id();
+    progress_requested = false;
+    pending_flushes = 0;
+    progress_done = false;
+    if( Config::APOLLO_PROGRESS_THREAD > 0 ) {
+        // Polls every APOLLO_PROGRESS_THREAD microseconds while idle.
+        progress_thread = std::thread( [this]() {
+            while( !progress_done.load() ) {
+                if( progress() == 0 )
+                    std::this_thread::sleep_for(
+                            std::chrono::microseconds( Config::APOLLO_PROGRESS_THREAD ) );
+            }
+        } );
+    }
+
+    if( Config::APOLLO_TRACE_POLICY ) {
+        policy_trace_file.open( "rank-" + std::to_string(mpiRank) + "-policies.txt", std::ofstream::app );
+        if( policy_trace_file.fail() ) {
+            std::cerr << "Error opening policy trace file" << std::endl;
+            abort();
+        }
+    }
+
     log("Initialized.");
 
     return;
@@ -214,16 +339,140 @@ Apollo::Apollo()
 
 Apollo::~Apollo()
 {
+    if( progress_thread.joinable() ) {
+        progress_done = true;
+        progress_thread.join();
+    }
+    progress();
+    // Every rank runs the same number of period flushes while MPI is up.
+    int finalized = 0;
+#ifdef ENABLE_MPI
+    MPI_Finalized( &finalized );
+#endif //ENABLE_MPI
+    if( !finalized )
+        flushPending();
+
+    size_t measures_entries = 0, measures_footprint = 0, best_entries = 0;
+    std::stringstream overhead_out;
     for(auto &it : regions) {
         Region *r = it.second;
-        delete r;
+        measures_entries += r->measures.size();
+        measures_footprint += r->getMeasuresFootprint();
+        best_entries += r->best_policies.size();
+
+        if( Config::APOLLO_TRACE_OVERHEAD ) {
+            overhead_out << "Apollo: region " << r->name \
+                << " executions " << r->executions \
+                << " time " << r->region_time << " s" \
+                << " overhead " << r->overhead_time << " s";
+            if( r->region_time > 0.0 )
+                overhead_out << " (" << ( 100.0 * r->overhead_time / r->region_time ) << "%)";
+            if( r->tuning_benefit >= 0.0 )
+                overhead_out << " benefit/exec " << r->tuning_benefit << " s";
+            if( r->frozen )
+                overhead_out << " frozen policy " << r->frozen_policy;
+            overhead_out << std::endl;
+        }
     }
+
+    // Each region removes itself from regions.
+    while( !regions.empty() )
+        delete regions.begin()->second;
+    // Drains outstanding trace records, after regions have collected theirs.
+    trace_writer.reset();
+    flushPolicyTrace();
+    timeline.reset();
+
     std::cerr << "Apollo: total region executions: " << region_executions << std::endl;
+    std::cerr << overhead_out.str();
+    if( Config::APOLLO_MEASURES_MAX_ENTRIES || Config::APOLLO_MEASURES_DECAY > 0 )
+        std::cerr << "Apollo: unflushed measures: " << measures_entries \
+            << " entries, " << measures_footprint << " bytes" \
+            << " (unbounded best policies: " << best_entries << " feature vectors)" << std::endl;
+}
+
+int
+Apollo::progress(bool blocking)
+{
+    // A caller that fails try_lock leaves progress_requested set, the
+    // holder collects again before and after releasing the lock so no
+    // completion stays queued.
+    progress_requested = true;
+    std::unique_lock<std::recursive_mutex> guard( progress_lock, std::defer_lock );
+    int collected = 0;
+    do {
+        if( blocking )
+            guard.lock();
+        else if( !guard.try_lock() )
+            return collected;
+        while( progress_requested.exchange( false ) )
+            collected += collectCompleted();
+        guard.unlock();
+    } while( progress_requested.load() );
+
+    return collected;
+}
+
+int
+Apollo::collectCompleted()
+{
+    int collected = 0;
+    while( Apollo::RegionContext *context = completion_queue->pop() ) {
+        context->region->collectContext( context, context->metric );
+        collected++;
+    }
+
+    for(auto &it : regions) {
+        size_t pending = it.second->pending_contexts.size();
+        if( pending > 0 ) {
+            it.second->collectPendingContexts();
+            collected += pending - it.second->pending_contexts.size();
+        }
+    }
+
+    return collected;
+}
+
+void
+Apollo::flushPending()
+{
+    if( std::this_thread::get_id() != application_thread )
+        return;
+    while( pending_flushes.load() > 0 ) {
+        pending_flushes--;
+        flushAllRegionMeasurements( region_executions );
+    }
+}
+
+void
+Apollo::tracePolicy(const std::string &event)
+{
+    // Large writes amortize the syscall over thousands of decisions.
+    static const size_t flush_size = 1 << 20;
+
+    std::lock_guard<std::mutex> guard( policy_trace_lock );
+    policy_trace_buffer += event;
+    if( policy_trace_buffer.size() >= flush_size ) {
+        policy_trace_file.write( policy_trace_buffer.data(), policy_trace_buffer.size() );
+        policy_trace_buffer.clear();
+    }
+}
+
+void
+Apollo::flushPolicyTrace()
+{
+    if( !policy_trace_file.is_open() )
+        return;
+
+    std::lock_guard<std::mutex> guard( policy_trace_lock );
+    policy_trace_file.write( policy_trace_buffer.data(), policy_trace_buffer.size() );
+    policy_trace_file.flush();
+    policy_trace_buffer.clear();
 }
 
 #ifdef ENABLE_MPI
 int
-get_mpi_pack_measure_size(int num_features, MPI_Comm comm)
+get_mpi_pack_measure_size(int num_features, int num_bins, MPI_Comm comm)
 {
     int size = 0, measure_size = 0;
     // rank
@@ -244,43 +493,104 @@ get_mpi_pack_measure_size(int num_features, MPI_Comm comm)
     // average time
     MPI_Pack_size( 1, MPI_DOUBLE, comm, &size);
     measure_size += size;
+    // number of sketch bins, -1 if no sketch
+    MPI_Pack_size( 1, MPI_INT, comm, &size);
+    measure_size += size;
+    if( num_bins >= 0 ) {
+        // sketch zero count
+        MPI_Pack_size( 1, MPI_DOUBLE, comm, &size);
+        measure_size += size;
+        // sketch bin indices and counts
+        MPI_Pack_size( num_bins, MPI_INT, comm, &size);
+        measure_size += size;
+        MPI_Pack_size( num_bins, MPI_DOUBLE, comm, &size);
+        measure_size += size;
+    }
 
     return measure_size;
 }
 
+// Feature vector has policy sketches, its best policy is then sent as the
+// sketches of all its policies.
+static bool
+isSketched(Apollo::Region *reg, const std::vector<float> &feature_vector)
+{
+    auto iter = reg->policy_sketches.lower_bound( { feature_vector, std::numeric_limits<int>::min() } );
+    return ( iter != reg->policy_sketches.end() && iter->first.first == feature_vector );
+}
+
+int
+get_mpi_pack_region_size(Apollo::Region *reg, MPI_Comm comm)
+{
+    // XXX assumes reg->reduceBestPolicies() has run
+    int size = 0;
+    for( auto &it : reg->policy_sketches )
+        size += get_mpi_pack_measure_size( reg->num_features, it.second->getBins().size(), comm );
+    for( auto &it : reg->best_policies )
+        if( !isSketched( reg, it.first ) )
+            size += get_mpi_pack_measure_size( reg->num_features, -1, comm );
+    return size;
+}
+
+void
+packSketch(char *buf, int size, int *pos, const QuantileSketch *sketch) {
+    int num_bins = sketch ? sketch->getBins().size() : -1;
+    MPI_Pack( &num_bins, 1, MPI_INT, buf, size, pos, apollo_mpi_comm );
+    if( !sketch )
+        return;
+
+    double zero_count = sketch->getZeroCount();
+    MPI_Pack( &zero_count, 1, MPI_DOUBLE, buf, size, pos, apollo_mpi_comm );
+    for( auto &b : sketch->getBins() ) {
+        int index = b.first;
+        MPI_Pack( &index, 1, MPI_INT, buf, size, pos, apollo_mpi_comm );
+    }
+    for( auto &b : sketch->getBins() ) {
+        double count = b.second;
+        MPI_Pack( &count, 1, MPI_DOUBLE, buf, size, pos, apollo_mpi_comm );
+    }
+}
+
+void
+packMeasure(char *buf, int size, int *pos, int mpiRank, Apollo::Region *reg,
+        const std::vector<float> &feature_vector, int policy_index, double time_avg,
+        const QuantileSketch *sketch) {
+    // rank
+    MPI_Pack( &mpiRank, 1, MPI_INT, buf, size, pos, apollo_mpi_comm );
+    // num features
+    MPI_Pack( &reg->num_features, 1, MPI_INT, buf, size, pos, apollo_mpi_comm );
+    // feature vector
+    for (float value : feature_vector ) {
+        MPI_Pack( &value, 1, MPI_FLOAT, buf, size, pos, apollo_mpi_comm);
+    }
+    // policy index
+    MPI_Pack( &policy_index, 1, MPI_INT, buf, size, pos, apollo_mpi_comm);
+    // XXX: use 64 bytes fixed for region_name
+    // region name
+    MPI_Pack( reg->name, 64, MPI_CHAR, buf, size, pos, apollo_mpi_comm);
+    // average time
+    MPI_Pack( &time_avg, 1, MPI_DOUBLE, buf, size, pos, apollo_mpi_comm);
+    // sketch
+    packSketch( buf, size, pos, sketch );
+}
+
 void
 packMeasurements(char *buf, int size, int mpiRank, Apollo::Region *reg) {
     int pos = 0;
 
+    // Sketched feature vectors send the sketch of every policy so ranks
+    // can merge full distributions, the others send their best policy.
+    for( auto &it : reg->policy_sketches ) {
+        QuantileSketch *sketch = it.second.get();
+        packMeasure( buf, size, &pos, mpiRank, reg,
+                it.first.first, it.first.second,
+                sketch->quantile( reg->objective_quantile ), sketch );
+    }
     for( auto &it : reg->best_policies ) {
-        auto &feature_vector = it.first;
-        int policy_index = it.second.first;
-        double time_avg = it.second.second;
-
-        // rank
-        MPI_Pack( &mpiRank, 1, MPI_INT, buf, size, &pos, apollo_mpi_comm );
-        //std::cout << "rank," << rank << " pos: " << pos << std::endl;
-
-        // num features
-        MPI_Pack( &reg->num_features, 1, MPI_INT, buf, size, &pos, apollo_mpi_comm );
-        //std::cout << "rank," << rank << " pos: " << pos << std::endl;
-
-        // feature vector
-        for (float value : feature_vector ) {
-            MPI_Pack( &value, 1, MPI_FLOAT, buf, size, &pos, apollo_mpi_comm);
-            //std::cout << "feature," << value << " pos: " << pos << std::endl;
-        }
-
-        // policy index
-        MPI_Pack( &policy_index, 1, MPI_INT, buf, size, &pos, apollo_mpi_comm);
-        //std::cout << "policy_index," << policy_index << " pos: " << pos << std::endl;
-        // XXX: use 64 bytes fixed for region_name
-        // region name
-        MPI_Pack( reg->name, 64, MPI_CHAR, buf, size, &pos, apollo_mpi_comm);
-        //std::cout << "region_name," << name << " pos: " << pos << std::endl;
-        // average time
-        MPI_Pack( &time_avg, 1, MPI_DOUBLE, buf, size, &pos, apollo_mpi_comm);
-        //std::cout << "time_avg," << time_avg << " pos: " << pos << std::endl;
+        if( isSketched( reg, it.first ) )
+            continue;
+        packMeasure( buf, size, &pos, mpiRank, reg,
+                it.first, it.second.first, it.second.second, nullptr );
     }
     return;
 }
@@ -290,6 +600,7 @@ packMeasurements(char *buf, int size, int mpiRank, Apollo::Region *reg) {
 void
 Apollo::gatherReduceCollectiveTrainingData(int step)
 {
+    Timeline::Scope scope( timeline.get(), "gatherReduceCollectiveTrainingData", "step", step );
 #ifndef ENABLE_MPI
     // MPI is disabled, skip everything in this method.
     //
@@ -304,8 +615,7 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
     int send_size = 0;
     for( auto &it: regions ) {
         Region *reg = it.second;
-        // XXX assumes reg->reduceBestPolicies() has run
-        send_size += ( get_mpi_pack_measure_size( reg->num_features, apollo_mpi_comm ) * reg->best_policies.size() );
+        send_size += get_mpi_pack_region_size( reg, apollo_mpi_comm );
     }
 
     char *sendbuf = (char *)malloc( send_size );
@@ -313,7 +623,7 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
     int offset = 0;
     for(auto it = regions.begin(); it != regions.end(); ++it) {
         Region *reg = it->second;
-        int reg_measures_size = ( reg->best_policies.size() * get_mpi_pack_measure_size( reg->num_features, apollo_mpi_comm ) );
+        int reg_measures_size = get_mpi_pack_region_size( reg, apollo_mpi_comm );
         packMeasurements( sendbuf + offset, reg_measures_size, mpiRank, reg );
         offset += reg_measures_size;
     }
@@ -364,6 +674,10 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
     //std::stringstream dbgout; \
     dbgout << "rank, region_name, features, policy_index, time_avg" << std::endl;
 
+    // Sketches merged across all ranks, including this one, per region.
+    std::map< Region *,
+        std::map< std::pair< std::vector<float>, int >, std::unique_ptr<QuantileSketch> > > merged_sketches;
+
     int pos = 0;
     while( pos < recv_size ) {
         int rank;
@@ -384,6 +698,21 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
         MPI_Unpack(recvbuf, recv_size, &pos, &policy_index, 1, MPI_INT, apollo_mpi_comm);
         MPI_Unpack(recvbuf, recv_size, &pos, region_name, 64, MPI_CHAR, apollo_mpi_comm);
         MPI_Unpack(recvbuf, recv_size, &pos, &time_avg, 1, MPI_DOUBLE, apollo_mpi_comm);
+        int num_bins;
+        MPI_Unpack(recvbuf, recv_size, &pos, &num_bins, 1, MPI_INT, apollo_mpi_comm);
+        std::unique_ptr<QuantileSketch> sketch;
+        if( num_bins >= 0 ) {
+            sketch = std::make_unique<QuantileSketch>( Config::APOLLO_SKETCH_ACCURACY );
+            double zero_count;
+            MPI_Unpack(recvbuf, recv_size, &pos, &zero_count, 1, MPI_DOUBLE, apollo_mpi_comm);
+            sketch->addZero( zero_count );
+            std::vector<int> indices( num_bins );
+            std::vector<double> counts( num_bins );
+            MPI_Unpack(recvbuf, recv_size, &pos, indices.data(), num_bins, MPI_INT, apollo_mpi_comm);
+            MPI_Unpack(recvbuf, recv_size, &pos, counts.data(), num_bins, MPI_DOUBLE, apollo_mpi_comm);
+            for(int j = 0; j < num_bins; j++)
+                sketch->addBin( indices[j], counts[j] );
+        }
 
         if( Config::APOLLO_TRACE_ALLGATHER ) {
             trace_out << rank << ", " << region_name << ", ";
@@ -398,7 +727,15 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
         // Find local region to reduce collective training data
         // TODO keep unseen regions to boostrap their models on execution?
         auto reg_iter = regions.find( region_name );
-        if( reg_iter != regions.end() ) {
+        if( reg_iter != regions.end() && sketch ) {
+            Region *reg = reg_iter->second;
+            auto &merged = merged_sketches[ reg ][ { feature_vector, policy_index } ];
+            if( merged )
+                merged->merge( *sketch );
+            else
+                merged = std::move( sketch );
+        }
+        else if( reg_iter != regions.end() ) {
             Region *reg = reg_iter->second;
             auto iter =  reg->best_policies.find( feature_vector );
             if( iter ==  reg->best_policies.end() ) {
@@ -413,6 +750,24 @@ Apollo::gatherReduceCollectiveTrainingData(int step)
         }
     }
 
+    // Pick the best policies of sketched feature vectors from merged
+    // distributions, unsketched ones keep the best gathered policy.
+    for( auto &it : merged_sketches ) {
+        Region *reg = it.first;
+        for( auto &m : it.second )
+            reg->best_policies.erase( m.first.first );
+        for( auto &m : it.second ) {
+            const std::vector<float> &feature_vector = m.first.first;
+            int policy_index = m.first.second;
+            double time_q = m.second->quantile( reg->objective_quantile );
+            auto iter = reg->best_policies.find( feature_vector );
+            if( iter == reg->best_policies.end() || iter->second.second > time_q )
+                reg->best_policies[ feature_vector ] = { policy_index, time_q };
+        }
+    }
+    for( auto &it: regions )
+        it.second->policy_sketches.clear();
+
     if( Config::APOLLO_TRACE_ALLGATHER ) {
         std::cout << trace_out.str() << std::endl;
         std::ofstream fout("step-" + std::to_string(step) + \
@@ -432,6 +787,9 @@ void
 Apollo::flushAllRegionMeasurements(int step)
 {
     int rank = mpiRank;  //Automatically 0 if not an MPI environment.
+    // Collectors update the same measures and models.
+    std::lock_guard<std::recursive_mutex> guard( progress_lock );
+    Timeline::Scope scope( timeline.get(), "flushAllRegionMeasurements", "step", step );
 
     // Reduce local region measurements to best policies
     // NOTE[chad]: reg->reduceBestPolicies() will guard any MPI collectives
@@ -442,10 +800,37 @@ Apollo::flushAllRegionMeasurements(int step)
     //             method we are in now is only being called once per
     //             simulation step, so this should have negligible performance
     //             impact.
+    flushPolicyTrace();
+
+    if( context_features )
+        context_features->refresh();
+
+    std::stringstream switches_out;
     for( auto &it: regions ) {
         Region *reg = it.second;
-        reg->reduceBestPolicies(step);
+        {
+            Timeline::Scope reduce_scope( timeline.get(), "reduceBestPolicies", "region", reg->name );
+            reg->reduceBestPolicies(step);
+        }
         reg->measures.clear();
+
+        if( Config::APOLLO_TRACE_SWITCHES ) {
+            switches_out << "step " << step \
+                << " rank " << rank \
+                << " region " << reg->name \
+                << " switches " << reg->switch_count \
+                << std::endl;
+        }
+        reg->switch_count = 0;
+    }
+
+    if( Config::APOLLO_TRACE_SWITCHES ) {
+        std::cout << switches_out.str();
+        std::ofstream fout("step-" + std::to_string(step) \
+                + "-rank-" + std::to_string(rank) \
+                + "-switches.txt");
+        fout << switches_out.str();
+        fout.close();
     }
 
     if( Config::APOLLO_COLLECTIVE_TRAINING ) {
@@ -503,7 +888,9 @@ Apollo::flushAllRegionMeasurements(int step)
     for( auto &it : regions ) {
         Region *reg = it.second;
 
-        if( reg->model->training && reg->best_policies.size() > 0 ) {
+        if( ( ( reg->model->training && !reg->model->keepAtFlush() ) || reg->explored_unseen )
+                && reg->best_policies.size() > 0 ) {
+            Timeline::Scope train_scope( timeline.get(), "train", "region", reg->name );
             if( Config::APOLLO_REGION_MODEL ) {
                 //std::cout << "TRAIN MODEL PER REGION" << std::endl;
                 // Reset training vectors
@@ -555,6 +942,15 @@ Apollo::flushAllRegionMeasurements(int step)
             reg->time_model = ModelFactory::createRegressionTree(
                     train_time_features,
                     train_time_responses );
+            if( timeline )
+                timeline->instant( "model-swap", "region", reg->name );
+
+            if( Config::APOLLO_GUIDED_EXPLORE ) {
+                reg->trained_features.clear();
+                reg->trained_features.insert( train_features.begin(), train_features.end() );
+                reg->explore_model = ModelFactory::createGuided( num_policies, reg->time_model );
+                reg->explored_unseen = false;
+            }
 
             if( Config::APOLLO_STORE_MODELS ) {
                 reg->model->store( "dtree-step-" + std::to_string( step ) \
@@ -564,6 +960,24 @@ Apollo::flushAllRegionMeasurements(int step)
                         "-rank-" + std::to_string( rank ) \
                         + "-" + reg->name + ".yaml" );
 
+                if( reg->quantizer ) {
+                    reg->quantizer->store( "dtree-step-" + std::to_string( step ) \
+                            + "-rank-" + std::to_string( rank ) \
+                            + "-" + reg->name + ".yaml.bins" );
+                    reg->quantizer->store( "dtree-latest" \
+                            "-rank-" + std::to_string( rank ) \
+                            + "-" + reg->name + ".yaml.bins" );
+                }
+
+                if( reg->parameters ) {
+                    reg->parameters->store( "dtree-step-" + std::to_string( step ) \
+                            + "-rank-" + std::to_string( rank ) \
+                            + "-" + reg->name + ".yaml.params" );
+                    reg->parameters->store( "dtree-latest" \
+                            "-rank-" + std::to_string( rank ) \
+                            + "-" + reg->name + ".yaml.params" );
+                }
+
                 reg->time_model->store("regtree-step-" + std::to_string( step ) \
                         + "-rank-" + std::to_string( rank ) \
                         + "-" + reg->name + ".yaml");
@@ -626,7 +1040,16 @@ Apollo::flushAllRegionMeasurements(int step)
                             << std::endl;
                     }
                     //reg->model = ModelFactory::createRandom( num_policies );
-                    reg->model = ModelFactory::createRoundRobin( num_policies );
+                    if( Config::APOLLO_GUIDED_EXPLORE )
+                        reg->model = ModelFactory::createGuided( num_policies, reg->time_model );
+                    else if( reg->knobs.size() > 1 )
+                        reg->model = ModelFactory::createFactorized( reg->knobs );
+                    else
+                        reg->model = ModelFactory::createRoundRobin( num_policies );
+                    if( timeline ) {
+                        timeline->instant( "drift", "region", reg->name );
+                        timeline->instant( "model-swap", "region", reg->name );
+                    }
                 }
 
                 if( Config::APOLLO_TRACE_RETRAIN ) {
@@ -641,6 +1064,15 @@ Apollo::flushAllRegionMeasurements(int step)
         }
 
         reg->best_policies.clear();
+
+        // Bins are learned between flushes, when measures and best policies
+        // hold no keys of the previous binning.  Per vector state of the
+        // region keyed by old bins is dropped with them.
+        if( reg->quantizer && reg->quantizer->fit() ) {
+            reg->trained_features.clear();
+            reg->cached_features.clear();
+            reg->cached_policy = -1;
+        }
     }
 
     return;
@@ -648,11 +1080,30 @@ Apollo::flushAllRegionMeasurements(int step)
 
 extern "C" {
  void *__apollo_region_create(int num_features, char *id, int num_policies) {
+     // Creates inside loops return the callsite's region from a per
+     // thread cache, the shared registry is only locked on a miss.
+     thread_local void *last_callsite = nullptr;
+     thread_local Apollo::Region *last_region = nullptr;
+     thread_local std::unordered_map<void *, Apollo::Region *> callsite_cache;
+     void *callsite = __builtin_return_address(0);
+     if( callsite == last_callsite )
+         return last_region;
+     last_callsite = callsite;
+     auto iter = callsite_cache.find( callsite );
+     if( iter != callsite_cache.end() ) {
+         last_region = iter->second;
+         return last_region;
+     }
+
      static Apollo *apollo = Apollo::instance();
-     std::string callpathOffset = apollo->getCallpathOffset(3);
-     std::cout << "CREATE region " << callpathOffset << " " << id << " num_features " << num_features
-               << " num policies " << num_policies << std::endl;
-     return new Apollo::Region(num_features, callpathOffset.c_str(), num_policies);
+     bool created;
+     Apollo::Region *region = apollo->getCallsiteRegion( callsite, num_features, num_policies, created );
+     if( created )
+         std::cout << "CREATE region " << region->name << " " << id << " num_features " << num_features
+                   << " num policies " << num_policies << std::endl;
+     callsite_cache.insert( { callsite, region } );
+     last_region = region;
+     return region;
  }
 
  void __apollo_region_begin(Apollo::Region *r) {
@@ -0,0 +1,81 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "apollo/CompletionQueue.h"
+
+CompletionQueue::CompletionQueue() :
+    head(&stub), tail(&stub)
+{
+    stub.completion_next.store( nullptr, std::memory_order_relaxed );
+}
+
+void
+CompletionQueue::push(Apollo::RegionContext *context)
+{
+    context->completion_next.store( nullptr, std::memory_order_relaxed );
+    Apollo::RegionContext *prev = head.exchange( context, std::memory_order_acq_rel );
+    prev->completion_next.store( context, std::memory_order_release );
+}
+
+Apollo::RegionContext *
+CompletionQueue::pop()
+{
+    Apollo::RegionContext *first = tail;
+    Apollo::RegionContext *next = first->completion_next.load( std::memory_order_acquire );
+
+    if( first == &stub ) {
+        if( !next )
+            return nullptr;
+        tail = next;
+        first = next;
+        next = next->completion_next.load( std::memory_order_acquire );
+    }
+
+    if( next ) {
+        tail = next;
+        return first;
+    }
+
+    // first is the last pushed context, unless a producer is between its
+    // exchange and link.  Re-insert the stub to detach it.
+    if( first != head.load( std::memory_order_acquire ) )
+        return nullptr;
+    push( &stub );
+    next = first->completion_next.load( std::memory_order_acquire );
+    if( next ) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
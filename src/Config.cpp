@@ -9,6 +9,9 @@ int Config::APOLLO_REGION_MODEL;
 int Config::APOLLO_TRACE_MEASURES;
 int Config::APOLLO_NUM_POLICIES;
 int Config::APOLLO_TRACE_POLICY;
+int Config::APOLLO_TRACE_POLICY_SAMPLE;
+int Config::APOLLO_TRACE_POLICY_ON_CHANGE;
+int Config::APOLLO_TRACE_POLICY_STDOUT;
 int Config::APOLLO_RETRAIN_ENABLE;
 float Config::APOLLO_RETRAIN_TIME_THRESHOLD;
 float Config::APOLLO_RETRAIN_REGION_THRESHOLD;
@@ -18,5 +21,37 @@ int Config::APOLLO_TRACE_ALLGATHER;
 int Config::APOLLO_TRACE_BEST_POLICIES;
 int Config::APOLLO_FLUSH_PERIOD;
 int Config::APOLLO_TRACE_CSV;
+int Config::APOLLO_TRACE_BINARY;
+int Config::APOLLO_TRACE_TIMELINE;
+int Config::APOLLO_TRACE_OVERHEAD;
+float Config::APOLLO_FREEZE_OVERHEAD_RATIO;
+int Config::APOLLO_SAMPLE_RATE;
+int Config::APOLLO_SAMPLE_TARGET;
+float Config::APOLLO_AGGREGATE_TARGET;
+std::string Config::APOLLO_TIMER;
+std::string Config::APOLLO_METRIC;
+std::string Config::APOLLO_CONTEXT_FEATURES;
+int Config::APOLLO_PROGRESS_THREAD;
+int Config::APOLLO_PARAMETER_CANDIDATES;
+int Config::APOLLO_PARAMETER_SAMPLES;
+float Config::APOLLO_RACING_CONFIDENCE;
+int Config::APOLLO_RACING_MIN_SAMPLES;
+int Config::APOLLO_RACING_MAX_SAMPLES;
+float Config::APOLLO_BANDIT_ALPHA;
+int Config::APOLLO_FACTORIZED_MIN_SAMPLES;
+int Config::APOLLO_FACTORIZED_PASSES;
+int Config::APOLLO_GUIDED_EXPLORE;
+float Config::APOLLO_GUIDED_EXPLORE_THRESHOLD;
+float Config::APOLLO_SWITCH_PENALTY;
+float Config::APOLLO_SWITCH_HYSTERESIS;
+int Config::APOLLO_SWITCH_MEASURE;
+int Config::APOLLO_TRACE_SWITCHES;
+float Config::APOLLO_OBJECTIVE_QUANTILE;
+float Config::APOLLO_SKETCH_ACCURACY;
+int Config::APOLLO_MEASURES_MAX_ENTRIES;
+float Config::APOLLO_MEASURES_DECAY;
+int Config::APOLLO_HEAVY_HITTERS;
+int Config::APOLLO_HEAVY_HITTER_THRESHOLD;
 std::string Config::APOLLO_INIT_MODEL;
 std::string Config::APOLLO_TRACE_CSV_FOLDER_SUFFIX;
+std::string Config::APOLLO_FEATURE_BINNING;
@@ -0,0 +1,116 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef ENABLE_OPENMP
+#include <omp.h>
+#endif
+
+#include "apollo/ContextFeatures.h"
+
+ContextFeatures::ContextFeatures(const std::string &spec) :
+    generation(0), env_threads(0)
+{
+    // The first level of a nested OMP_NUM_THREADS list, e.g. "8,2".
+    const char *omp_threads = getenv( "OMP_NUM_THREADS" );
+    if( omp_threads )
+        env_threads = std::max( atoi( omp_threads ), 0 );
+
+    std::stringstream ss( spec );
+    std::string name;
+    while( std::getline( ss, name, ',' ) ) {
+        if( name == "threads" )
+            kinds.push_back( Kind::Threads );
+        else if( name == "affinity" )
+            kinds.push_back( Kind::Affinity );
+        else if( name == "numa" )
+            kinds.push_back( Kind::Numa );
+        else if( name == "oversubscribed" )
+            kinds.push_back( Kind::Oversubscribed );
+        else {
+            std::cerr << "Invalid context feature " << name \
+                << ", expected threads, affinity, numa or oversubscribed" << std::endl;
+            abort();
+        }
+    }
+}
+
+void
+ContextFeatures::compute(std::vector<float> &values) const
+{
+#ifdef ENABLE_OPENMP
+    int threads = omp_get_max_threads();
+#else
+    // Hardware concurrency would flag every pinned rank as oversubscribed.
+    int threads = env_threads;
+#endif
+    cpu_set_t mask;
+    int affinity = 0;
+    if( sched_getaffinity( 0, sizeof(mask), &mask ) == 0 )
+        affinity = CPU_COUNT( &mask );
+    unsigned cpu = 0, node = 0;
+    syscall( SYS_getcpu, &cpu, &node, nullptr );
+
+    values.clear();
+    for(auto kind : kinds) {
+        switch( kind ) {
+            case Kind::Threads:        values.push_back( threads ); break;
+            case Kind::Affinity:       values.push_back( affinity ); break;
+            case Kind::Numa:           values.push_back( node ); break;
+            case Kind::Oversubscribed: values.push_back( threads > 0 && threads > affinity ); break;
+        }
+    }
+}
+
+void
+ContextFeatures::append(std::vector<float> &features)
+{
+    thread_local unsigned cached_generation = ~0u;
+    thread_local std::vector<float> cached;
+
+    unsigned current = generation.load( std::memory_order_relaxed );
+    if( cached_generation != current ) {
+        compute( cached );
+        cached_generation = current;
+    }
+    features.insert( features.end(), cached.begin(), cached.end() );
+}
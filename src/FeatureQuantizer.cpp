@@ -0,0 +1,168 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+
+#include "apollo/FeatureQuantizer.h"
+
+static inline float
+binLog2(float value)
+{
+    if( value == 0.0f )
+        return 0.0f;
+    return std::copysign( std::exp2( std::floor( std::log2( std::fabs( value ) ) ) ), value );
+}
+
+FeatureQuantizer::FeatureQuantizer(const std::string &spec) :
+    binning(Binning::Log2), width(1.0f), num_bins(0)
+{
+    size_t pos = spec.find(",");
+    std::string kind = spec.substr(0, pos);
+    if( "log2" == kind ) {
+        binning = Binning::Log2;
+    }
+    else if( "linear" == kind && pos != std::string::npos ) {
+        binning = Binning::Linear;
+        width = std::stof( spec.substr( pos + 1 ) );
+    }
+    else if( "quantile" == kind && pos != std::string::npos ) {
+        binning = Binning::Quantile;
+        num_bins = std::stoi( spec.substr( pos + 1 ) );
+    }
+    else {
+        std::cerr << "Invalid feature binning: " << spec << std::endl;
+        abort();
+    }
+
+    if( width <= 0.0f || ( binning == Binning::Quantile && num_bins < 1 ) ) {
+        std::cerr << "Invalid feature binning: " << spec << std::endl;
+        abort();
+    }
+}
+
+void
+FeatureQuantizer::fit(Feature &feature)
+{
+    std::sort( feature.samples.begin(), feature.samples.end() );
+    for(int i = 0; i < num_bins; i++) {
+        float edge = feature.samples[ ( i * feature.samples.size() ) / num_bins ];
+        if( feature.edges.empty() || edge > feature.edges.back() )
+            feature.edges.push_back( edge );
+    }
+    std::vector<float>().swap( feature.samples );
+}
+
+bool
+FeatureQuantizer::fit()
+{
+    bool changed = false;
+    for(auto &feature : features) {
+        if( feature.edges.empty() && feature.samples.size() >= samplesToFit() ) {
+            fit( feature );
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+float
+FeatureQuantizer::apply(size_t pos, float value)
+{
+    switch( binning ) {
+        case Binning::Log2:
+            return binLog2( value );
+        case Binning::Linear:
+            return std::floor( value / width ) * width;
+        case Binning::Quantile:
+            break;
+    }
+
+    if( pos >= features.size() )
+        features.resize( pos + 1 );
+    Feature &feature = features[ pos ];
+
+    if( feature.edges.empty() ) {
+        if( feature.samples.size() < samplesToFit() )
+            feature.samples.push_back( value );
+        return binLog2( value );
+    }
+
+    auto iter = std::upper_bound( feature.edges.begin(), feature.edges.end(), value );
+    if( iter == feature.edges.begin() )
+        return feature.edges.front();
+    return *( iter - 1 );
+}
+
+void
+FeatureQuantizer::store(const std::string &filename) const
+{
+    std::ofstream fout( filename );
+    fout << std::setprecision( std::numeric_limits<float>::max_digits10 );
+    fout << static_cast<int>( binning ) << " " << width << " " << num_bins << "\n";
+    fout << features.size() << "\n";
+    for(auto &feature : features) {
+        fout << feature.edges.size();
+        for(auto &e : feature.edges)
+            fout << " " << e;
+        fout << "\n";
+    }
+}
+
+bool
+FeatureQuantizer::load(const std::string &filename)
+{
+    std::ifstream fin( filename );
+    if( !fin.good() )
+        return false;
+
+    int kind;
+    size_t num_features;
+    fin >> kind >> width >> num_bins >> num_features;
+    binning = static_cast<Binning>( kind );
+    features.assign( num_features, Feature() );
+    for(auto &feature : features) {
+        size_t num_edges;
+        fin >> num_edges;
+        feature.edges.resize( num_edges );
+        for(auto &e : feature.edges)
+            fin >> e;
+    }
+
+    return !fin.fail();
+}
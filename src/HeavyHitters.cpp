@@ -0,0 +1,73 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <algorithm>
+
+#include "apollo/HeavyHitters.h"
+
+HeavyHitters::HeavyHitters(int capacity, int threshold) :
+    capacity( std::max( capacity, 1 ) ),
+    threshold( std::max( threshold, 1 ) )
+{
+    return;
+}
+
+bool
+HeavyHitters::observe(const std::vector<float> &features,
+        std::vector<float> &evicted, bool &has_evicted)
+{
+    has_evicted = false;
+
+    auto iter = counters.find( features );
+    if( iter != counters.end() ) {
+        by_count.erase( { iter->second.count, &iter->first } );
+        iter->second.count++;
+    }
+    else if( counters.size() < capacity ) {
+        iter = counters.insert( { features, { 1, 0 } } ).first;
+    }
+    else {
+        // Replace the least frequent vector, inheriting its count as error.
+        auto min = by_count.begin();
+        unsigned long long min_count = min->first;
+        evicted = *min->second;
+        has_evicted = true;
+        by_count.erase( min );
+        counters.erase( evicted );
+        iter = counters.insert( { features, { min_count + 1, min_count } } ).first;
+    }
+    by_count.insert( { iter->second.count, &iter->first } );
+
+    return ( iter->second.count - iter->second.error ) >= threshold;
+}
@@ -0,0 +1,58 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "apollo/MetricProvider.h"
+#include "apollo/metrics/WallTime.h"
+#include "apollo/metrics/ThreadCPUTime.h"
+#include "apollo/metrics/PerfEvent.h"
+
+std::unique_ptr<MetricProvider>
+MetricProvider::create(const std::string &name)
+{
+    if( name == "wall" )
+        return std::make_unique<WallTime>();
+    if( name == "cputime" )
+        return std::make_unique<ThreadCPUTime>();
+
+    const std::string perf( "perf:" );
+    if( name.compare( 0, perf.size(), perf ) == 0 ) {
+        std::string event = name.substr( perf.size() );
+        uint32_t type;
+        uint64_t config;
+        if( PerfEvent::lookup( event, type, config ) )
+            return std::make_unique<PerfEvent>( type, config, event );
+    }
+
+    return nullptr;
+}
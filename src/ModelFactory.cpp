@@ -1,8 +1,13 @@
 #include "apollo/ModelFactory.h"
+#include "apollo/Config.h"
 
 #include "apollo/models/Static.h"
 #include "apollo/models/Random.h"
 #include "apollo/models/RoundRobin.h"
+#include "apollo/models/Racing.h"
+#include "apollo/models/Bandit.h"
+#include "apollo/models/Factorized.h"
+#include "apollo/models/Guided.h"
 #include "apollo/models/DecisionTree.h"
 #include "apollo/models/RegressionTree.h"
 
@@ -18,6 +23,33 @@ std::unique_ptr<PolicyModel> ModelFactory::createRoundRobin(int num_policies) {
     return std::make_unique<RoundRobin>( num_policies );
 }
 
+std::unique_ptr<PolicyModel> ModelFactory::createRacing(int num_policies) {
+    return std::make_unique<Racing>( num_policies,
+            Config::APOLLO_RACING_CONFIDENCE,
+            Config::APOLLO_RACING_MIN_SAMPLES,
+            Config::APOLLO_RACING_MAX_SAMPLES );
+}
+
+std::unique_ptr<PolicyModel> ModelFactory::createBandit(int num_policies) {
+    return std::make_unique<Bandit>( num_policies, Config::APOLLO_BANDIT_ALPHA );
+}
+
+std::unique_ptr<PolicyModel> ModelFactory::loadBandit(int num_policies, std::string path) {
+    return std::make_unique<Bandit>( num_policies, Config::APOLLO_BANDIT_ALPHA, path );
+}
+
+std::unique_ptr<PolicyModel> ModelFactory::createFactorized(const std::vector<int> &knobs) {
+    return std::make_unique<Factorized>( knobs,
+            Config::APOLLO_FACTORIZED_MIN_SAMPLES,
+            Config::APOLLO_FACTORIZED_PASSES );
+}
+
+std::unique_ptr<PolicyModel> ModelFactory::createGuided(int num_policies,
+        std::shared_ptr<TimingModel> time_model ) {
+    return std::make_unique<Guided>( num_policies, time_model,
+            Config::APOLLO_GUIDED_EXPLORE_THRESHOLD );
+}
+
 
 std::unique_ptr<PolicyModel> ModelFactory::loadDecisionTree(int num_policies,
         std::string path) {
@@ -0,0 +1,311 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#include "apollo/ParameterTuner.h"
+
+ParameterTuner::ParameterTuner(int num_candidates, int num_samples) :
+    num_candidates(num_candidates), num_samples(num_samples)
+{
+}
+
+int
+ParameterTuner::add(const Parameter &parameter)
+{
+    if( parameter.max < parameter.min || ( parameter.log_scale && parameter.min <= 0.0 ) ) {
+        std::cerr << "Invalid range of tuning parameter " << parameter.name << std::endl;
+        abort();
+    }
+    // Names are whitespace-delimited in stored files.
+    if( parameter.name.empty() ||
+            std::any_of( parameter.name.begin(), parameter.name.end(), ::isspace ) ) {
+        std::cerr << "Invalid name of tuning parameter '" << parameter.name << "'" << std::endl;
+        abort();
+    }
+
+    for(size_t i = 0; i < parameters.size(); i++) {
+        if( parameters[i].name == parameter.name ) {
+            parameters[i] = parameter;
+            return i;
+        }
+    }
+
+    // Searches and loaded leaders lack the new parameter, start over.
+    parameters.push_back( parameter );
+    searches.clear();
+    return parameters.size() - 1;
+}
+
+double
+ParameterTuner::scale(const Parameter &parameter, double u) const
+{
+    double value;
+    if( parameter.log_scale )
+        value = std::exp( std::log( parameter.min ) + u * ( std::log( parameter.max ) - std::log( parameter.min ) ) );
+    else
+        value = parameter.min + u * ( parameter.max - parameter.min );
+    if( parameter.integer )
+        value = std::round( value );
+    return std::min( std::max( value, parameter.min ), parameter.max );
+}
+
+ParameterTuner::Search &
+ParameterTuner::getSearch(const std::vector<float> &features)
+{
+    auto iter = searches.find( features );
+    if( iter != searches.end() )
+        return iter->second;
+
+    Search &search = searches[ features ];
+    search.rung_samples = num_samples;
+    search.next = 0;
+    search.winner = ( num_candidates == 1 ) ? 0 : -1;
+    search.candidates.resize( num_candidates );
+    for(auto &c : search.candidates) {
+        c.values.resize( parameters.size() );
+        c.total = 0.0;
+        c.count = 0;
+        c.alive = true;
+    }
+
+    // Candidate 0 is the center of the ranges, the others stratify every
+    // parameter in num_candidates - 1 strata.  Seeded for reproducibility.
+    std::mt19937 rng( 1 );
+    std::uniform_real_distribution<double> jitter( 0.0, 1.0 );
+    int strata = num_candidates - 1;
+    std::vector<int> order( strata );
+    for(size_t p = 0; p < parameters.size(); p++) {
+        search.candidates[0].values[p] = scale( parameters[p], 0.5 );
+        std::iota( order.begin(), order.end(), 0 );
+        std::shuffle( order.begin(), order.end(), rng );
+        for(int i = 0; i < strata; i++)
+            search.candidates[ i + 1 ].values[p] = scale( parameters[p], ( order[i] + jitter( rng ) ) / strata );
+    }
+
+    return search;
+}
+
+int
+ParameterTuner::leader(const Search &search) const
+{
+    if( search.winner >= 0 )
+        return search.winner;
+
+    int best = 0;
+    double best_mean = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < search.candidates.size(); i++) {
+        const Candidate &c = search.candidates[i];
+        if( !c.alive || c.count == 0 )
+            continue;
+        double mean = c.total / c.count;
+        if( mean < best_mean ) {
+            best = i;
+            best_mean = mean;
+        }
+    }
+    return best;
+}
+
+bool
+ParameterTuner::searching() const
+{
+    for(auto &it : searches)
+        if( it.second.winner < 0 )
+            return true;
+    return false;
+}
+
+int
+ParameterTuner::select(const std::vector<float> &features, bool explore)
+{
+    Search &search = getSearch( features );
+    if( !explore || search.winner >= 0 )
+        return leader( search );
+
+    // Round-robin over live candidates short of the rung's samples.
+    int n = search.candidates.size();
+    for(int i = 0; i < n; i++) {
+        int candidate = ( search.next + i ) % n;
+        const Candidate &c = search.candidates[ candidate ];
+        if( c.alive && c.count < search.rung_samples ) {
+            search.next = candidate + 1;
+            return candidate;
+        }
+    }
+    return leader( search );
+}
+
+const std::vector<double> &
+ParameterTuner::values(const std::vector<float> &features, int candidate)
+{
+    return getSearch( features ).candidates[ candidate ].values;
+}
+
+const std::vector<double> &
+ParameterTuner::nearest(const std::vector<float> &features)
+{
+    auto best = searches.find( features );
+    if( best == searches.end() ) {
+        double best_distance = std::numeric_limits<double>::max();
+        for(auto it = searches.begin(); it != searches.end(); ++it) {
+            if( it->first.size() != features.size() )
+                continue;
+            double distance = 0.0;
+            for(size_t i = 0; i < features.size(); i++)
+                distance += ( it->first[i] - features[i] ) * ( it->first[i] - features[i] );
+            if( distance < best_distance ) {
+                best = it;
+                best_distance = distance;
+            }
+        }
+    }
+    if( best == searches.end() )
+        return values( features, 0 );
+    return best->second.candidates[ leader( best->second ) ].values;
+}
+
+void
+ParameterTuner::halve(Search &search)
+{
+    std::vector<int> alive;
+    for(size_t i = 0; i < search.candidates.size(); i++)
+        if( search.candidates[i].alive )
+            alive.push_back( i );
+
+    std::sort( alive.begin(), alive.end(), [&search](int a, int b) {
+            const Candidate &ca = search.candidates[a];
+            const Candidate &cb = search.candidates[b];
+            return ca.total / ca.count < cb.total / cb.count;
+            } );
+
+    size_t keep = ( alive.size() + 1 ) / 2;
+    for(size_t i = keep; i < alive.size(); i++)
+        search.candidates[ alive[i] ].alive = false;
+
+    if( keep == 1 )
+        search.winner = alive[0];
+    search.rung_samples *= 2;
+    search.next = 0;
+}
+
+void
+ParameterTuner::update(const std::vector<float> &features, int candidate, double metric)
+{
+    Search &search = getSearch( features );
+    if( search.winner >= 0 )
+        return;
+
+    Candidate &c = search.candidates[ candidate ];
+    if( !c.alive )
+        return;
+    c.total += metric;
+    c.count++;
+
+    for(auto &other : search.candidates)
+        if( other.alive && other.count < search.rung_samples )
+            return;
+    halve( search );
+}
+
+void
+ParameterTuner::store(const std::string &filename)
+{
+    // Enough digits for features and values to load back exactly.
+    const int float_digits = std::numeric_limits<float>::max_digits10;
+    const int double_digits = std::numeric_limits<double>::max_digits10;
+    std::ofstream fout( filename );
+    fout << parameters.size() << "\n";
+    fout << std::setprecision( double_digits );
+    for(auto &p : parameters)
+        fout << p.name << " " << p.min << " " << p.max << " "
+            << p.integer << " " << p.log_scale << "\n";
+    fout << searches.size() << "\n";
+    for(auto &it : searches) {
+        fout << it.first.size();
+        fout << std::setprecision( float_digits );
+        for(auto &f : it.first)
+            fout << " " << f;
+        fout << std::setprecision( double_digits );
+        for(auto &v : it.second.candidates[ leader( it.second ) ].values)
+            fout << " " << v;
+        fout << "\n";
+    }
+}
+
+bool
+ParameterTuner::load(const std::string &filename)
+{
+    std::ifstream fin( filename );
+    if( !fin.good() )
+        return false;
+
+    size_t num_parameters;
+    fin >> num_parameters;
+    parameters.assign( num_parameters, Parameter() );
+    for(auto &p : parameters)
+        fin >> p.name >> p.min >> p.max >> p.integer >> p.log_scale;
+
+    size_t num_searches;
+    fin >> num_searches;
+    searches.clear();
+    for(size_t i = 0; i < num_searches && fin.good(); i++) {
+        size_t num_features;
+        fin >> num_features;
+        std::vector<float> features( num_features );
+        for(auto &f : features)
+            fin >> f;
+        Search &search = searches[ features ];
+        search.candidates.resize( 1 );
+        search.candidates[0].values.resize( num_parameters );
+        for(auto &v : search.candidates[0].values)
+            fin >> v;
+        search.candidates[0].total = 0.0;
+        search.candidates[0].count = 0;
+        search.candidates[0].alive = true;
+        search.rung_samples = num_samples;
+        search.next = 0;
+        search.winner = 0;
+    }
+
+    return !fin.fail();
+}
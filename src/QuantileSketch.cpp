@@ -0,0 +1,134 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <cmath>
+#include <iterator>
+
+#include "apollo/QuantileSketch.h"
+
+static const double min_indexable_value = 1e-12;
+
+QuantileSketch::QuantileSketch(double relative_accuracy, int max_bins) :
+    relative_accuracy(relative_accuracy),
+    gamma( ( 1.0 + relative_accuracy ) / ( 1.0 - relative_accuracy ) ),
+    log_gamma( std::log( gamma ) ),
+    max_bins(max_bins),
+    zero_count(0.0),
+    total(0.0)
+{
+    return;
+}
+
+void
+QuantileSketch::add(double value, double weight)
+{
+    if( value <= min_indexable_value )
+        addZero( weight );
+    else
+        addBin( static_cast<int>( std::ceil( std::log( value ) / log_gamma ) ), weight );
+}
+
+void
+QuantileSketch::addBin(int index, double weight)
+{
+    bins[ index ] += weight;
+    total += weight;
+    if( static_cast<int>( bins.size() ) > max_bins )
+        collapse();
+}
+
+void
+QuantileSketch::addZero(double weight)
+{
+    zero_count += weight;
+    total += weight;
+}
+
+void
+QuantileSketch::collapse()
+{
+    // Fold the lowest bins together, keeping accuracy for the high
+    // quantiles we care about.
+    while( static_cast<int>( bins.size() ) > max_bins ) {
+        auto lowest = bins.begin();
+        auto next = std::next( lowest );
+        next->second += lowest->second;
+        bins.erase( lowest );
+    }
+}
+
+void
+QuantileSketch::scale(double factor)
+{
+    zero_count *= factor;
+    total *= factor;
+    for(auto &b : bins)
+        b.second *= factor;
+}
+
+size_t
+QuantileSketch::getFootprint() const
+{
+    // Red-black tree node: 3 pointers and color, plus the value.
+    return sizeof(*this) +
+        bins.size() * ( 4 * sizeof(void *) + sizeof(std::pair<const int, double>) );
+}
+
+void
+QuantileSketch::merge(const QuantileSketch &other)
+{
+    addZero( other.zero_count );
+    for(auto &b : other.bins)
+        addBin( b.first, b.second );
+}
+
+double
+QuantileSketch::quantile(double q) const
+{
+    if( total <= 0.0 )
+        return 0.0;
+
+    double rank = q * ( total - 1.0 );
+    double seen = zero_count;
+    if( seen > rank )
+        return 0.0;
+
+    for(auto &b : bins) {
+        seen += b.second;
+        if( seen > rank )
+            return 2.0 * std::pow( gamma, b.first ) / ( gamma + 1.0 );
+    }
+
+    return 2.0 * std::pow( gamma, bins.rbegin()->first ) / ( gamma + 1.0 );
+}
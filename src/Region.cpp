@@ -39,6 +39,8 @@
 #include <memory>
 #include <utility>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -49,6 +51,10 @@
 #include "apollo/Region.h"
 #include "apollo/Logging.h"
 #include "apollo/ModelFactory.h"
+#include "apollo/TraceWriter.h"
+#include "apollo/Timeline.h"
+#include "apollo/ContextFeatures.h"
+#include "apollo/CompletionQueue.h"
 
 #ifdef ENABLE_MPI
 #include <mpi.h>
@@ -57,23 +63,182 @@
 int
 Apollo::Region::getPolicyIndex(Apollo::RegionContext *context)
 {
-    int choice = model->getIndex( context->features );
+    if( context == frozen_context.get() )
+        return frozen_policy;
 
-    if( Config::APOLLO_TRACE_POLICY ) {
-        std::stringstream trace_out;
-        int rank;
-        rank = apollo->mpiRank;
-        trace_out << "Rank " << rank \
-            << " region " << name \
-            << " model " << model->name \
-            << " features [ ";
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+
+    if( context == call_context.get() )
+        return getBatchPolicy( context );
+
+    if( context->weight == 0.0 && cached_policy >= 0 && context->features == cached_features ) {
+        context->policy = cached_policy;
+        return cached_policy;
+    }
+
+    Timer::tick_t overhead_begin = 0;
+    if( account_overhead )
+        overhead_begin = Timer::now();
+
+    PolicyModel *policy_model = model.get();
+    if( explore_model && !model->training &&
+            trained_features.find( context->features ) == trained_features.end() ) {
+        policy_model = explore_model.get();
+        explored_unseen = true;
+    }
+
+    int choice = applyPolicy( context, policy_model, policy_model->getIndex( context->features ) );
+
+    if( account_overhead && context->weight > 0.0 )
+        overhead_time += Timer::seconds( Timer::now() - overhead_begin );
+    return choice;
+}
+
+bool
+Apollo::Region::getCachedPolicy(const float *features, size_t num_features, int &policy)
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+
+    // Context features, aggregation and parameters need a context.
+    if( apollo->context_features || call_context || parameters )
+        return false;
+
+    if( apollo->pending_flushes.load( std::memory_order_relaxed ) > 0 )
+        apollo->flushPending();
+
+    if( frozen ) {
+        policy = frozen_policy;
+        countExecution();
+        return true;
+    }
+
+    // Same test as begin() and getPolicyIndex() for an unsampled execution.
+    if( sample_rate <= 1 || ( sample_count % sample_rate ) == 0 || cached_policy < 0 ||
+            cached_features.size() != num_features )
+        return false;
+    for(size_t i = 0; i < num_features; i++) {
+        float value = quantizer ? quantizer->apply( i, features[i] ) : features[i];
+        if( value != cached_features[i] )
+            return false;
+    }
+
+    sample_count++;
+    idx++;
+    policy = cached_policy;
+    countExecution();
+    collectPendingContexts();
+    return true;
+}
+
+void
+Apollo::Region::getPolicyIndexBatch(std::vector<Apollo::RegionContext *> &contexts, std::vector<int> &policies)
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+
+    policies.resize( contexts.size() );
+    batch_features.clear();
+    batch_rows.clear();
+    for(size_t i = 0; i < contexts.size(); i++) {
+        Apollo::RegionContext *context = contexts[i];
+        // Unsampled executions reuse the cached policy as in getPolicyIndex.
+        if( context->weight == 0.0 && context != frozen_context.get() && context != call_context.get() &&
+                cached_policy >= 0 && context->features == cached_features ) {
+            context->policy = cached_policy;
+            policies[i] = cached_policy;
+            continue;
+        }
+        // Special contexts, partial feature vectors and unseen features
+        // routed to exploration take the single path.
+        if( context == frozen_context.get() || context == call_context.get() ||
+                context->features.size() != static_cast<size_t>( num_features ) ||
+                ( explore_model && !model->training &&
+                  trained_features.find( context->features ) == trained_features.end() ) ) {
+            policies[i] = getPolicyIndex( context );
+            continue;
+        }
+        batch_rows.push_back( i );
+        batch_features.insert( batch_features.end(), context->features.begin(), context->features.end() );
+    }
+    if( batch_rows.empty() )
+        return;
+
+    Timer::tick_t overhead_begin = 0;
+    if( account_overhead )
+        overhead_begin = Timer::now();
+
+    batch_policies.resize( batch_rows.size() );
+    model->getIndexBatch( batch_features.data(), batch_rows.size(), num_features, batch_policies.data() );
+    for(size_t j = 0; j < batch_rows.size(); j++)
+        policies[ batch_rows[j] ] = applyPolicy( contexts[ batch_rows[j] ], model.get(), batch_policies[j] );
+
+    if( account_overhead )
+        overhead_time += Timer::seconds( Timer::now() - overhead_begin );
+}
+
+void
+Apollo::Region::endBatch(std::vector<Apollo::RegionContext *> &contexts)
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    current_context = nullptr;
+
+    // One end timestamp for all contexts.
+    Timer::tick_t now = Timer::now();
+    for(auto context : contexts) {
+        if( context == frozen_context.get() || context == call_context.get() ||
+                context->weight == 0.0 || context->isDoneCallback || metric_provider ) {
+            end( context );
+            continue;
+        }
+        double metric = Timer::seconds( now - context->exec_time_begin );
+        // Overhead runs from exec_time_end, restamp so each context is
+        // charged its own collection only.
+        context->exec_time_end = account_overhead ? Timer::now() : now;
+        collectContext( context, metric );
+    }
+
+    collectPendingContexts();
+}
+
+void
+Apollo::Region::endBatch(std::vector<Apollo::RegionContext *> &contexts, const std::vector<double> &metrics)
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+
+    for(size_t i = 0; i < contexts.size(); i++)
+        end( contexts[i], metrics[i] );
+}
+
+int
+Apollo::Region::applyPolicy(Apollo::RegionContext *context, PolicyModel *policy_model, int choice)
+{
+    // Exploring models switch by design, hysteresis only applies to
+    // exploitation.
+    if( last_policy >= 0 && choice != last_policy && !policy_model->training &&
+            !isSwitchProfitable( context->features, last_policy, choice ) )
+        choice = last_policy;
+
+    context->switched = ( last_policy >= 0 && choice != last_policy );
+    if( context->switched ) {
+        switch_count++;
+        // Exploration switches on every execution, only trace exploitation.
+        if( apollo->timeline && !policy_model->training )
+            apollo->timeline->instant( "policy-switch", "region", name );
+    }
+    last_policy = choice;
+
+    if( Config::APOLLO_TRACE_POLICY &&
+            ( !Config::APOLLO_TRACE_POLICY_ON_CHANGE || context->switched ) &&
+            ( trace_policy_count++ % Config::APOLLO_TRACE_POLICY_SAMPLE ) == 0 ) {
+        std::string trace_out = "Rank " + std::to_string( apollo->mpiRank ) +
+            " region " + name +
+            " model " + policy_model->name +
+            " features [ ";
         for(auto &f: context->features)
-            trace_out << (int)f << ", ";
-        trace_out << "] policy " << choice << std::endl;
-        std::cout << trace_out.str();
-        std::ofstream fout( "rank-" + std::to_string(rank) + "-policies.txt", std::ofstream::app );
-        fout << trace_out.str();
-        fout.close();
+            trace_out += std::to_string( (int)f ) + ", ";
+        trace_out += "] policy " + std::to_string( choice ) + "\n";
+        if( Config::APOLLO_TRACE_POLICY_STDOUT )
+            std::cout << trace_out;
+        apollo->tracePolicy( trace_out );
     }
 
 #if 0
@@ -90,10 +255,107 @@ Apollo::Region::getPolicyIndex(Apollo::RegionContext *context)
     }
 #endif
     context->policy = choice;
+    if( sample_rate > 1 ) {
+        cached_features = context->features;
+        cached_policy = choice;
+    }
     //log("getPolicyIndex took ", evaluation_time_total, " seconds.\n");
     return choice;
 }
 
+bool
+Apollo::Region::predictTime(std::vector<float> &features, int policy, double &time)
+{
+    auto iter = measures.find( { features, policy } );
+    if( iter != measures.end() && iter->second->exec_count > 0 ) {
+        time = iter->second->time_mean;
+        return true;
+    }
+
+    if( time_model ) {
+        std::vector<float> feature_vector = features;
+        feature_vector.push_back( policy );
+        time = time_model->getTimePrediction( feature_vector );
+        return true;
+    }
+
+    return false;
+}
+
+bool
+Apollo::Region::isSwitchProfitable(std::vector<float> &features, int from, int to)
+{
+    double penalty = std::max( switch_penalty, measured_switch_penalty );
+    if( penalty <= 0.0 && Config::APOLLO_SWITCH_HYSTERESIS <= 0.0 )
+        return true;
+
+    double time_from, time_to;
+    if( !predictTime( features, from, time_from ) || !predictTime( features, to, time_to ) )
+        return true;
+
+    return ( time_from - time_to ) > ( penalty + Config::APOLLO_SWITCH_HYSTERESIS * time_from );
+}
+
+void
+Apollo::Region::setObjectiveQuantile(double q)
+{
+    if( q < 0.0 || q >= 1.0 ) {
+        std::cerr << "Invalid objective quantile " << q << std::endl;
+        abort();
+    }
+    objective_quantile = q;
+}
+
+double
+Apollo::Region::getObjective(const Apollo::Region::Measure &measure) const
+{
+    if( objective_quantile > 0.0 && measure.sketch )
+        return measure.sketch->quantile( objective_quantile );
+
+    return measure.time_mean;
+}
+
+void
+Apollo::Region::setKnobs(const std::vector<int> &sizes)
+{
+    int count = 1;
+    for(auto &s : sizes)
+        count *= s;
+    if( sizes.empty() || count != model->policy_count ) {
+        std::cerr << "Knob sizes of region " << name << " multiply to " << count \
+            << ", expected " << model->policy_count << " policies" << std::endl;
+        abort();
+    }
+
+    knobs = sizes;
+    if( model->name == "Factorized" )
+        model = ModelFactory::createFactorized( knobs );
+}
+
+int
+Apollo::Region::getPolicyTuple(Apollo::RegionContext *context, std::vector<int> &choices)
+{
+    int policy = getPolicyIndex( context );
+    if( knobs.empty() ) {
+        choices.assign( 1, policy );
+        return policy;
+    }
+
+    choices.resize( knobs.size() );
+    int rest = policy;
+    for(size_t k = knobs.size(); k-- > 0; ) {
+        choices[k] = rest % knobs[k];
+        rest /= knobs[k];
+    }
+    return policy;
+}
+
+void
+Apollo::Region::setSwitchPenalty(double penalty)
+{
+    switch_penalty = penalty;
+}
+
 Apollo::Region::Region(
         const int num_features,
         const char  *regionName,
@@ -101,9 +363,41 @@ Apollo::Region::Region(
         Apollo::CallbackDataPool *callbackPool,
         const std::string &modelYamlFile)
     :
-        num_features(num_features), current_context(nullptr), idx(0), callback_pool(callbackPool)
+        idx(0), num_features(num_features), objective_quantile(0.0), switch_count(0),
+        executions(0), region_time(0.0), overhead_time(0.0), tuning_benefit(-1.0),
+        frozen(false), frozen_policy(0), sample_rate(Config::APOLLO_SAMPLE_RATE),
+        callback_pool(callbackPool), explored_unseen(false), current_context(nullptr),
+        trace_policy_count(0), last_policy(-1),
+        switch_penalty(Config::APOLLO_SWITCH_PENALTY), measured_switch_penalty(0.0)
 {
     apollo = Apollo::instance();
+    account_overhead = ( Config::APOLLO_TRACE_OVERHEAD || Config::APOLLO_FREEZE_OVERHEAD_RATIO > 0.0 );
+    wall_time_metric = true;
+    timed_executions = 0;
+    sample_count = 0;
+    flushed_executions = 0;
+    context_size = 0;
+    if( apollo->context_features ) {
+        context_size = apollo->context_features->size();
+        this->num_features += context_size;
+    }
+    cached_policy = -1;
+    aggregate_target = 0.0;
+    batch_size = 1;
+    batch_context = nullptr;
+    batch_count = 0;
+    batch_metric = 0.0;
+    batch_has_metric = false;
+    if( Config::APOLLO_AGGREGATE_TARGET > 0.0 )
+        setAggregate( Config::APOLLO_AGGREGATE_TARGET );
+    if( Config::APOLLO_METRIC != "wall" ) {
+        metric_provider = MetricProvider::create( Config::APOLLO_METRIC );
+        if( !metric_provider ) {
+            std::cerr << "Invalid APOLLO_METRIC " << Config::APOLLO_METRIC \
+                << ", expected wall, cputime or perf:<event>" << std::endl;
+            abort();
+        }
+    }
     if( Config::APOLLO_NUM_POLICIES ) {
         apollo->num_policies = Config::APOLLO_NUM_POLICIES;
     }
@@ -111,11 +405,22 @@ Apollo::Region::Region(
         apollo->num_policies = numAvailablePolicies;
     }
 
+    setObjectiveQuantile( Config::APOLLO_OBJECTIVE_QUANTILE );
+
+    if( Config::APOLLO_HEAVY_HITTERS > 0 )
+        heavy_hitters = std::make_unique<HeavyHitters>(
+                Config::APOLLO_HEAVY_HITTERS, Config::APOLLO_HEAVY_HITTER_THRESHOLD );
+
+    if( !Config::APOLLO_FEATURE_BINNING.empty() )
+        quantizer = std::make_unique<FeatureQuantizer>( Config::APOLLO_FEATURE_BINNING );
+
     strncpy(name, regionName, sizeof(name)-1 );
     name[ sizeof(name)-1 ] = '\0';
 
     if (!modelYamlFile.empty()) {
         model = ModelFactory::loadDecisionTree(apollo->num_policies, modelYamlFile);
+        loadFeatureBinning(modelYamlFile);
+        loadParameters(modelYamlFile);
     }
     else {
         // TODO use best_policies to train a model for new region for which there's training data
@@ -147,6 +452,8 @@ Apollo::Region::Region(
             }
             //std::cout << "Model Load " << model_file << std::endl;
             model = ModelFactory::loadDecisionTree(apollo->num_policies, model_file);
+            loadFeatureBinning(model_file);
+            loadParameters(model_file);
         }
         else if ("Random" == model_str)
         {
@@ -158,6 +465,24 @@ Apollo::Region::Region(
             model = ModelFactory::createRoundRobin(apollo->num_policies);
             //std::cout << "Model RoundRobin" << std::endl;
         }
+        else if ("Racing" == model_str)
+        {
+            model = ModelFactory::createRacing(apollo->num_policies);
+        }
+        else if ("Bandit" == model_str)
+        {
+            // Bandit,<file> resumes a stored Bandit.
+            if (pos == std::string::npos)
+                model = ModelFactory::createBandit(apollo->num_policies);
+            else
+                model = ModelFactory::loadBandit(apollo->num_policies,
+                        Config::APOLLO_INIT_MODEL.substr(pos + 1));
+        }
+        else if ("Factorized" == model_str)
+        {
+            // A single knob until setKnobs declares the structure.
+            model = ModelFactory::createFactorized({ apollo->num_policies });
+        }
         else
         {
             std::cerr << "Invalid model env var: " + Config::APOLLO_INIT_MODEL << std::endl;
@@ -165,7 +490,12 @@ Apollo::Region::Region(
         }
     }
 
-    if( Config::APOLLO_TRACE_CSV ) {
+    // Ids are never reused, regions may share a name or be removed.
+    id = apollo->next_region_id++;
+    // The trace writer records executions of regions up to
+    // APOLLO_TRACE_MAX_FEATURES wide, wider regions write the CSV directly.
+    trace_binary = ( apollo->trace_writer && apollo->trace_writer->addRegion( id, name, this->num_features ) );
+    if( Config::APOLLO_TRACE_CSV && !trace_binary ) {
         // TODO: assumes model comes from env, fix to use model provided in the constructor
         // TODO: convert to filesystem C++17 API when Apollo moves to it
         int ret;
@@ -190,27 +520,105 @@ Apollo::Region::Region(
         // Write header.
         trace_file << "rankid training region idx";
         //trace_file << "features";
-        for(int i=0; i<num_features; i++)
+        for(int i=0; i<this->num_features; i++)
             trace_file << " f" << i;
         trace_file << " policy xtime\n";
     }
+
     //std::cout << "Insert region " << name << " ptr " << this << std::endl;
+    // Collectors iterate regions under progress_lock.
+    std::lock_guard<std::recursive_mutex> guard( apollo->progress_lock );
     const auto ret = apollo->regions.insert( { name, this } );
 
     return;
 }
 
+void
+Apollo::Region::loadFeatureBinning(const std::string &model_file)
+{
+    // The model was trained on binned features, infer with the same bins.
+    std::unique_ptr<FeatureQuantizer> loaded = std::make_unique<FeatureQuantizer>( "log2" );
+    if( loaded->load( model_file + ".bins" ) )
+        quantizer = std::move( loaded );
+}
+
+void
+Apollo::Region::loadParameters(const std::string &model_file)
+{
+    std::unique_ptr<ParameterTuner> loaded = std::make_unique<ParameterTuner>(
+            Config::APOLLO_PARAMETER_CANDIDATES, Config::APOLLO_PARAMETER_SAMPLES );
+    if( loaded->load( model_file + ".params" ) )
+        parameters = std::move( loaded );
+}
+
+int
+Apollo::Region::addParameter(const std::string &name, double min, double max,
+        bool integer, bool log_scale)
+{
+    if( !parameters )
+        parameters = std::make_unique<ParameterTuner>(
+                Config::APOLLO_PARAMETER_CANDIDATES, Config::APOLLO_PARAMETER_SAMPLES );
+    return parameters->add( { name, min, max, integer, log_scale } );
+}
+
+double
+Apollo::Region::getParameter(Apollo::RegionContext *context, int parameter)
+{
+    // Aggregate mode calls run with the open batch's parameters.
+    if( context == call_context.get() && batch_context )
+        context = batch_context;
+
+    if( !parameters ) {
+        std::cerr << "== APOLLO: getParameter on region " << name \
+            << " without parameters, call addParameter first" << std::endl;
+        abort();
+    }
+
+    if( context->param_values.empty() ) {
+        std::unique_lock<std::recursive_mutex> guard = progressGuard();
+        if( context == frozen_context.get() ) {
+            // Frozen after every search settled, run the closest leader.
+            context->param_candidate = -1;
+            context->param_values = parameters->nearest( context->features );
+        }
+        else {
+            // Unsampled executions run the leader.
+            context->param_candidate = parameters->select( context->features, context->weight > 0.0 );
+            context->param_values = parameters->values( context->features, context->param_candidate );
+        }
+    }
+    return context->param_values[ parameter ];
+}
+
 Apollo::Region::~Region()
 {
+    std::lock_guard<std::recursive_mutex> guard( apollo->progress_lock );
     // Disable period based flushing.
     Config::APOLLO_FLUSH_PERIOD = 0;
+    // Queued completions of this region are collected before it goes away.
+    apollo->collectCompleted();
     while(pending_contexts.size() > 0)
        collectPendingContexts();
+    auto iter = apollo->regions.find( name );
+    if( iter != apollo->regions.end() && iter->second == this )
+        apollo->regions.erase( iter );
+    // An open aggregate batch is dropped unmeasured.
+    delete batch_context;
+
+    // Models kept at flush are never stored by training, keep the latest.
+    if( model->keepAtFlush() && Config::APOLLO_STORE_MODELS )
+        model->store( model->name + "-latest-rank-" + std::to_string( apollo->mpiRank ) \
+                + "-" + std::string( name ) + ".txt" );
+
+    // Parameter searches progress without training, keep the latest.
+    if( parameters && Config::APOLLO_STORE_MODELS )
+        parameters->store( "dtree-latest-rank-" + std::to_string( apollo->mpiRank ) \
+                + "-" + std::string( name ) + ".yaml.params" );
 
     if(callback_pool)
         delete callback_pool;
 
-    if( Config::APOLLO_TRACE_CSV )
+    if( trace_file.is_open() )
         trace_file.close();
 
     return;
@@ -219,43 +627,150 @@ Apollo::Region::~Region()
 Apollo::RegionContext *
 Apollo::Region::begin()
 {
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+
+    if( apollo->pending_flushes.load( std::memory_order_relaxed ) > 0 )
+        apollo->flushPending();
+
+    if( frozen ) {
+        // Features only pick the parameters of a frozen region.
+        if( parameters ) {
+            frozen_context->features.clear();
+            frozen_context->param_values.clear();
+            if( apollo->context_features )
+                apollo->context_features->append( frozen_context->features );
+        }
+        current_context = frozen_context.get();
+        return current_context;
+    }
+
+    if( call_context ) {
+        call_context->features.clear();
+        call_context->param_values.clear();
+        if( apollo->context_features )
+            apollo->context_features->append( call_context->features );
+        current_context = call_context.get();
+        return current_context;
+    }
+
+    Timer::tick_t overhead_begin = 0;
+    if( account_overhead )
+        overhead_begin = Timer::now();
+
     Apollo::RegionContext *context = new Apollo::RegionContext();
     current_context = context;
     context->idx = this->idx;
     this->idx++;
-    context->exec_time_begin = std::chrono::steady_clock::now();
+    context->switched = false;
     context->isDoneCallback = nullptr;
     context->callback_arg = nullptr;
+    if( apollo->context_features )
+        apollo->context_features->append( context->features );
+    if( sample_rate > 1 && ( sample_count++ % sample_rate ) != 0 ) {
+        context->weight = 0.0;
+        return context;
+    }
+    context->weight = sample_rate;
+    context->exec_time_begin = Timer::now();
+    if( metric_provider )
+        context->metric_begin = metric_provider->start();
+    if( account_overhead )
+        overhead_time += Timer::seconds( context->exec_time_begin - overhead_begin );
     return context;
 }
 
 Apollo::RegionContext *
 Apollo::Region::begin(std::vector<float> features)
 {
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
     Apollo::RegionContext *context = begin();
-    context->features = features;
+    if( context == frozen_context.get() && !parameters )
+        return context;
+    if( quantizer ) {
+        for(size_t i = 0; i < features.size(); i++)
+            features[i] = quantizer->apply( i, features[i] );
+    }
+    context->features.insert( context->features.end(), features.begin(), features.end() );
     return context;
 }
 
+bool
+Apollo::Region::isHeavyHitter(const std::vector<float> &features)
+{
+    std::vector<float> evicted;
+    bool has_evicted;
+    bool frequent = heavy_hitters->observe( features, evicted, has_evicted );
+
+    // Drop every policy measured for the vector leaving the top-k.
+    if( has_evicted ) {
+        measures.erase(
+                measures.lower_bound( { evicted, std::numeric_limits<int>::min() } ),
+                measures.upper_bound( { evicted, std::numeric_limits<int>::max() } ) );
+    }
+
+    return frequent;
+}
+
+void
+Apollo::Region::recordMeasure(Apollo::RegionContext *context, double metric)
+{
+    auto iter = measures.find({context->features, context->policy});
+    if (iter == measures.end()) {
+        iter = measures
+                   .insert(std::make_pair(
+                       std::make_pair(context->features, context->policy),
+                       std::move(
+                           std::make_unique<Apollo::Region::Measure>())))
+                   .first;
+        if( objective_quantile > 0.0 )
+            iter->second->sketch = std::make_unique<QuantileSketch>( Config::APOLLO_SKETCH_ACCURACY );
+    }
+    else if( Config::APOLLO_MEASURES_DECAY > 0 ) {
+        // Exponential decay with a half-life in region executions.
+        int age = context->idx - iter->second->last_update;
+        if( age > 0 )
+            iter->second->decay( std::exp2( -static_cast<double>( age ) / Config::APOLLO_MEASURES_DECAY ) );
+    }
+    iter->second->last_update = context->idx;
+
+    // The first execution after a switch pays the switch cost, estimate it
+    // as the excess over the established mean of the new policy.
+    if( Config::APOLLO_SWITCH_MEASURE && context->switched && iter->second->exec_count > 1 ) {
+        double excess = std::max( metric - iter->second->time_mean, 0.0 );
+        measured_switch_penalty += 0.1 * ( excess - measured_switch_penalty );
+    }
+
+    iter->second->add(metric, context->weight);
+
+    if( Config::APOLLO_MEASURES_MAX_ENTRIES &&
+            measures.size() > static_cast<size_t>( Config::APOLLO_MEASURES_MAX_ENTRIES ) )
+        evictColdMeasures();
+}
+
 void
 Apollo::Region::collectContext(Apollo::RegionContext *context, double metric)
 {
   // std::cout << "COLLECT CONTEXT " << context->idx << " REGION " << name \
             << " metric " << metric << std::endl;
-  auto iter = measures.find({context->features, context->policy});
-  if (iter == measures.end()) {
-    iter = measures
-               .insert(std::make_pair(
-                   std::make_pair(context->features, context->policy),
-                   std::move(
-                       std::make_unique<Apollo::Region::Measure>(1, metric))))
-               .first;
-    } else {
-        iter->second->exec_count++;
-        iter->second->time_total += metric;
-    }
+    measureContext( context, metric );
+    delete context;
+    countExecution();
+}
+
+void
+Apollo::Region::measureContext(Apollo::RegionContext *context, double metric)
+{
+    if( !heavy_hitters || isHeavyHitter( context->features ) )
+        recordMeasure( context, metric );
+
+    model->update(context->features, context->policy, metric);
+    // Values chosen before a parameter was added belong to no search.
+    if( context->param_values.size() > 0 && context->param_values.size() == parameters->size() )
+        parameters->update( context->features, context->param_candidate, metric );
 
-    if( Config::APOLLO_TRACE_CSV ) {
+    region_time += context->weight * metric;
+
+    if( trace_file.is_open() ) {
         trace_file << apollo->mpiRank << " ";
         trace_file << Config::APOLLO_INIT_MODEL << " ";
         trace_file << this->name << " ";
@@ -266,22 +781,389 @@ Apollo::Region::collectContext(Apollo::RegionContext *context, double metric)
         trace_file << metric << "\n";
     }
 
+    if( trace_binary ) {
+        TraceRecord record;
+        record.rank = apollo->mpiRank;
+        record.region_id = id;
+        record.idx = context->idx;
+        record.policy = context->policy;
+        record.num_features = context->features.size();
+        std::copy_n( context->features.begin(), record.num_features, record.features );
+        std::fill( record.features + record.num_features,
+                record.features + APOLLO_TRACE_MAX_FEATURES, 0.0f );
+        record.time = metric;
+        apollo->trace_writer->write( record );
+    }
+
+    // The flush in countExecution is accounted to the whole runtime, not
+    // this region.
+    if( account_overhead ) {
+        overhead_time += Timer::seconds( Timer::now() - context->exec_time_end );
+        timed_executions++;
+    }
+}
+
+void
+Apollo::Region::setAggregate(double target)
+{
+    if( batch_context )
+        closeBatch();
+    aggregate_target = target;
+    batch_size = 1;
+    if( target > 0.0 ) {
+        call_context = std::make_unique<Apollo::RegionContext>();
+        call_context->idx = 0;
+        call_context->policy = 0;
+        call_context->switched = false;
+        call_context->weight = 0.0;
+        call_context->isDoneCallback = nullptr;
+        call_context->callback_arg = nullptr;
+    }
+    else
+        call_context.reset();
+}
+
+int
+Apollo::Region::getBatchPolicy(Apollo::RegionContext *context)
+{
+    if( batch_context ) {
+        if( batch_count < batch_size && context->features == batch_context->features ) {
+            context->policy = batch_context->policy;
+            return context->policy;
+        }
+        closeBatch();
+    }
+
+    batch_context = new Apollo::RegionContext();
+    batch_context->idx = this->idx;
+    this->idx++;
+    batch_context->switched = false;
+    batch_context->weight = 1.0;
+    batch_context->isDoneCallback = nullptr;
+    batch_context->callback_arg = nullptr;
+    batch_context->features = context->features;
+    context->policy = getPolicyIndex( batch_context );
+    batch_context->exec_time_begin = Timer::now();
+    if( metric_provider )
+        batch_context->metric_begin = metric_provider->start();
+    return context->policy;
+}
+
+void
+Apollo::Region::endBatchCall(bool has_metric, double metric)
+{
+    if( batch_context ) {
+        batch_count++;
+        if( has_metric ) {
+            batch_metric += metric;
+            batch_has_metric = true;
+        }
+        if( batch_count >= batch_size )
+            closeBatch();
+    }
+    countExecution();
+}
+
+void
+Apollo::Region::closeBatch()
+{
+    Apollo::RegionContext *context = batch_context;
+    batch_context = nullptr;
+    if( batch_count > 0 ) {
+        double total = stopMetric( context, true );
+        double elapsed = Timer::seconds( context->exec_time_end - context->exec_time_begin );
+        if( batch_has_metric )
+            total = batch_metric;
+
+        // Grow or shrink the batch so that it lasts aggregate_target.
+        if( !batch_has_metric && elapsed > 0.0 ) {
+            double size = std::ceil( aggregate_target * batch_count / elapsed );
+            batch_size = static_cast<int>( std::min( std::max( size, 1.0 ), 1048576.0 ) );
+        }
+
+        context->weight = batch_count;
+        measureContext( context, total / batch_count );
+    }
+    delete context;
+    batch_count = 0;
+    batch_metric = 0.0;
+    batch_has_metric = false;
+}
+
+std::unique_lock<std::recursive_mutex>
+Apollo::Region::progressGuard()
+{
+    return std::unique_lock<std::recursive_mutex>( apollo->progress_lock );
+}
+
+void
+Apollo::Region::complete(Apollo::RegionContext *context)
+{
+    if( context == frozen_context.get() || context == call_context.get() || context->weight == 0.0 ) {
+        std::lock_guard<std::recursive_mutex> guard( apollo->progress_lock );
+        end( context );
+        return;
+    }
+
+    context->metric = stopMetric( context, false );
+    context->has_metric = true;
+    context->region = this;
+    apollo->completion_queue->push( context );
+}
+
+Apollo::AsyncContext
+Apollo::Region::beginAsync()
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    return Apollo::AsyncContext( this, begin() );
+}
+
+Apollo::AsyncContext
+Apollo::Region::beginAsync(std::vector<float> features)
+{
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    return Apollo::AsyncContext( this, begin( std::move( features ) ) );
+}
+
+Apollo::AsyncContext &
+Apollo::AsyncContext::operator=(Apollo::AsyncContext &&other)
+{
+    if( this != &other ) {
+        if( context )
+            complete();
+        region = other.region;
+        context = other.context;
+        other.context = nullptr;
+    }
+    return *this;
+}
+
+void
+Apollo::AsyncContext::setFeature(float value)
+{
+    if( !context ) {
+        std::cerr << "== APOLLO: setFeature on a completed or moved AsyncContext" << std::endl;
+        abort();
+    }
+    region->setFeature( context, value );
+}
+
+int
+Apollo::AsyncContext::getPolicyIndex()
+{
+    if( !context ) {
+        std::cerr << "== APOLLO: getPolicyIndex on a completed or moved AsyncContext" << std::endl;
+        abort();
+    }
+    return region->getPolicyIndex( context );
+}
+
+void
+Apollo::AsyncContext::complete()
+{
+    if( !context )
+        return;
+    region->complete( context );
+    context = nullptr;
+    // Collect now unless another thread is already collecting.
+    region->apollo->progress( false );
+}
+
+void
+Apollo::AsyncContext::complete(double metric)
+{
+    if( !context )
+        return;
+    region->complete( context, metric );
+    context = nullptr;
+    region->apollo->progress( false );
+}
+
+void
+Apollo::Region::complete(Apollo::RegionContext *context, double metric)
+{
+    if( context == frozen_context.get() || context == call_context.get() || context->weight == 0.0 ) {
+        std::lock_guard<std::recursive_mutex> guard( apollo->progress_lock );
+        end( context, metric );
+        return;
+    }
+
+    context->exec_time_end = Timer::now();
+    context->metric = metric;
+    context->has_metric = true;
+    context->region = this;
+    apollo->completion_queue->push( context );
+}
+
+void
+Apollo::Region::setMetricProvider(std::unique_ptr<MetricProvider> provider)
+{
+    metric_provider = std::move( provider );
+}
+
+double
+Apollo::Region::stopMetric(Apollo::RegionContext *context, bool same_thread)
+{
+    context->exec_time_end = Timer::now();
+    if( metric_provider ) {
+        if( same_thread || !metric_provider->perThread() )
+            return metric_provider->stop( context->metric_begin );
+        static std::atomic<bool> warned( false );
+        if( !warned.exchange( true ) )
+            std::cerr << "== APOLLO: Metric " << metric_provider->name << " is per thread, " \
+                << "asynchronous executions measure wall time" << std::endl;
+    }
+    return Timer::seconds( context->exec_time_end - context->exec_time_begin );
+}
+
+void
+Apollo::Region::setSampleRate(int n)
+{
+    sample_rate = std::max( n, 1 );
+    cached_policy = -1;
+}
+
+void
+Apollo::Region::countExecution()
+{
+    executions++;
     apollo->region_executions++;
 
     if( Config::APOLLO_FLUSH_PERIOD && ( apollo->region_executions%Config::APOLLO_FLUSH_PERIOD ) == 0 ) {
         //std::cout << "FLUSH PERIOD! region_executions " << apollo->region_executions<< std::endl; //ggout
-        apollo->flushAllRegionMeasurements(apollo->region_executions);
+        if( std::this_thread::get_id() == apollo->application_thread )
+            apollo->flushAllRegionMeasurements(apollo->region_executions);
+        else
+            apollo->pending_flushes++;
     }
+}
 
-    delete context;
-    current_context = nullptr;
+void
+Apollo::Region::checkFreeze()
+{
+    // Time lost per execution to policies slower than the best one for the
+    // same features, a bound on what tuning this region can gain.  Only
+    // vectors that ran more than one policy tell, an exploiting model runs
+    // one per vector and keeps the estimate from exploration.
+    double lost = 0.0;
+    unsigned long long count = 0;
+    // Policy the model ran for every vector, -1 if it varies.
+    int policy = measures.empty() ? -1 : measures.begin()->first.second;
+    for(auto first = measures.begin(); first != measures.end(); ) {
+        auto last = measures.upper_bound( { first->first.first, std::numeric_limits<int>::max() } );
+        if( std::next( first ) != last ) {
+            double best = std::numeric_limits<double>::max();
+            for(auto m = first; m != last; ++m)
+                best = std::min( best, m->second->time_mean );
+            for(auto m = first; m != last; ++m) {
+                lost += m->second->exec_count * ( m->second->time_mean - best );
+                count += m->second->exec_count;
+            }
+            policy = -1;
+        }
+        else if( first->first.second != policy )
+            policy = -1;
+        first = last;
+    }
+    if( count > 0 )
+        tuning_benefit = lost / count;
+
+    // Overhead is in seconds, the benefit only when the metric is time.
+    // Open parameter searches still need measurements.
+    if( Config::APOLLO_FREEZE_OVERHEAD_RATIO <= 0.0 || model->training || tuning_benefit < 0.0 ||
+            !wall_time_metric || metric_provider || policy < 0 ||
+            ( parameters && parameters->searching() ) )
+        return;
+
+    // Overhead per timed execution, unsampled ones are cheaper.
+    if( timed_executions == 0 )
+        return;
+    double overhead = overhead_time / timed_executions;
+    if( overhead < Config::APOLLO_FREEZE_OVERHEAD_RATIO * tuning_benefit )
+        return;
+
+    // Freezing runs one policy for any features, only freeze a model that
+    // chose the same policy for every vector.
+    frozen_policy = policy;
+    frozen_context = std::make_unique<Apollo::RegionContext>();
+    frozen_context->idx = 0;
+    frozen_context->policy = frozen_policy;
+    frozen_context->switched = false;
+    frozen_context->weight = 0.0;
+    frozen_context->isDoneCallback = nullptr;
+    frozen_context->callback_arg = nullptr;
+    frozen = true;
+
+    std::cerr << "== APOLLO: Freeze region " << name << " to policy " << frozen_policy \
+        << ", overhead/exec " << overhead << " s, benefit/exec " << tuning_benefit << " s" << std::endl;
+}
+
+void
+Apollo::Region::evictColdMeasures()
+{
+    // Evict an eighth of the capacity at once to amortize the scan.
+    size_t num_evict = std::max( Config::APOLLO_MEASURES_MAX_ENTRIES / 8, 1 );
+    num_evict = std::min( num_evict, measures.size() );
+
+    // Coldest first: lowest decayed weight if decaying, else least recently updated.
+    std::vector< std::pair< double, decltype( measures.begin() ) > > coldness;
+    coldness.reserve( measures.size() );
+    for(auto iter = measures.begin(); iter != measures.end(); ++iter) {
+        double score = iter->second->last_update;
+        if( Config::APOLLO_MEASURES_DECAY > 0 ) {
+            score = std::log2( iter->second->weight ) -
+                static_cast<double>( idx - iter->second->last_update ) / Config::APOLLO_MEASURES_DECAY;
+        }
+        coldness.push_back( { score, iter } );
+    }
+
+    auto by_score = [](const decltype( coldness )::value_type &a,
+            const decltype( coldness )::value_type &b) { return a.first < b.first; };
+    std::nth_element( coldness.begin(), coldness.begin() + ( num_evict - 1 ), coldness.end(), by_score );
+    for(size_t i = 0; i < num_evict; i++)
+        measures.erase( coldness[ i ].second );
+}
+
+size_t
+Apollo::Region::getMeasuresFootprint() const
+{
+    // Red-black tree node: 3 pointers and color, plus the key/value pair.
+    const size_t node_size = 4 * sizeof(void *) + sizeof( decltype( measures )::value_type );
+
+    size_t footprint = 0;
+    for(auto &it : measures) {
+        footprint += node_size + sizeof( Apollo::Region::Measure );
+        footprint += it.first.first.capacity() * sizeof(float);
+        if( it.second->sketch )
+            footprint += it.second->sketch->getFootprint();
+    }
+    return footprint;
 }
 
 void
 Apollo::Region::end(Apollo::RegionContext *context, double metric)
 {
     //std::cout << "END REGION " << name << " metric " << metric << std::endl;
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    wall_time_metric = false;
+    current_context = nullptr;
+    if( context == frozen_context.get() ) {
+        countExecution();
+        return;
+    }
+    if( context == call_context.get() ) {
+        endBatchCall( true, metric );
+        return;
+    }
+    if( context->weight == 0.0 ) {
+        delete context;
+        countExecution();
+        collectPendingContexts();
+        return;
+    }
 
+    if( account_overhead )
+        context->exec_time_end = Timer::now();
     collectContext(context, metric);
 
     collectPendingContexts();
@@ -294,13 +1176,14 @@ void Apollo::Region::collectPendingContexts() {
     bool returnsMetric;
     double metric;
     if (context->isDoneCallback(context->callback_arg, &returnsMetric, &metric)) {
-      if (returnsMetric)
+      if (returnsMetric) {
+        wall_time_metric = false;
+        if (account_overhead)
+          context->exec_time_end = Timer::now();
         collectContext(context, metric);
+      }
       else {
-        context->exec_time_end = std::chrono::steady_clock::now();
-        double duration = std::chrono::duration<double>(
-                              context->exec_time_end - context->exec_time_begin)
-                              .count();
+        double duration = stopMetric(context, false);
         collectContext(context, duration);
       }
       return true;
@@ -317,13 +1200,27 @@ void Apollo::Region::collectPendingContexts() {
 void
 Apollo::Region::end(Apollo::RegionContext *context)
 {
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    current_context = nullptr;
+    if( context == frozen_context.get() ) {
+        countExecution();
+        return;
+    }
+    if( context == call_context.get() ) {
+        endBatchCall( false, 0.0 );
+        return;
+    }
+    if( context->weight == 0.0 ) {
+        delete context;
+        countExecution();
+        collectPendingContexts();
+        return;
+    }
+
     if(context->isDoneCallback)
         pending_contexts.push_back(context);
     else {
-      context->exec_time_end = std::chrono::steady_clock::now();
-      double duration = std::chrono::duration<double>(context->exec_time_end -
-                                                      context->exec_time_begin)
-                            .count();
+      double duration = stopMetric(context, true);
       collectContext(context, duration);
     }
 
@@ -364,7 +1261,8 @@ Apollo::Region::reduceBestPolicies(int step)
         rank = 0;
 #endif //ENABLE_MPI
         trace_out << "=================================" << std::endl \
-            << "Rank " << rank << " Region " << name << " MEASURES "  << std::endl;
+            << "Rank " << rank << " Region " << name << " MEASURES "
+            << measures.size() << " entries " << getMeasuresFootprint() << " bytes" << std::endl;
     }
     for (auto iter_measure = measures.begin();
             iter_measure != measures.end();   iter_measure++) {
@@ -382,9 +1280,13 @@ Apollo::Region::reduceBestPolicies(int step)
                 << "policy: " << policy_index
                 << " , count: " << time_set->exec_count
                 << " , total: " << time_set->time_total
-                << " , time_avg: " <<  ( time_set->time_total / time_set->exec_count ) << std::endl;
+                << " , stddev: " << std::sqrt( time_set->variance() )
+                << " , time_avg: " <<  time_set->time_mean;
+            if( objective_quantile > 0.0 )
+                trace_out << " , p" << ( objective_quantile * 100 ) << ": " << getObjective( *time_set );
+            trace_out << std::endl;
         }
-        double time_avg = ( time_set->time_total / time_set->exec_count );
+        double time_avg = getObjective( *time_set );
 
         auto iter =  best_policies.find( feature_vector );
         if( iter ==  best_policies.end() ) {
@@ -396,6 +1298,10 @@ Apollo::Region::reduceBestPolicies(int step)
                 best_policies[ feature_vector ] = { policy_index, time_avg };
             }
         }
+
+        // Keep the sketch to merge the full distribution across ranks.
+        if( Config::APOLLO_COLLECTIVE_TRAINING && time_set->sketch )
+            policy_sketches[ iter_measure->first ] = std::move( time_set->sketch );
     }
 
     if( Config::APOLLO_TRACE_MEASURES ) {
@@ -416,12 +1322,27 @@ Apollo::Region::reduceBestPolicies(int step)
         fout.close();
     }
 
+    if( account_overhead )
+        checkFreeze();
+
+    if( Config::APOLLO_SAMPLE_TARGET > 0 ) {
+        unsigned long long period = executions - flushed_executions;
+        if( period > 0 )
+            setSampleRate( period / Config::APOLLO_SAMPLE_TARGET );
+    }
+    flushed_executions = executions;
+
     return best_policies.size();
 }
 
 void
 Apollo::Region::setFeature(Apollo::RegionContext *context, float value)
 {
+    if( context == frozen_context.get() && !parameters )
+        return;
+    std::unique_lock<std::recursive_mutex> guard = progressGuard();
+    if( quantizer )
+        value = quantizer->apply( context->features.size() - context_size, value );
     context->features.push_back(value);
     return;
 }
@@ -0,0 +1,199 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+
+#include "apollo/Timeline.h"
+
+static std::string
+escape(const std::string &s)
+{
+    std::string out;
+    for(auto c : s) {
+        if( c == '"' || c == '\\' )
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+namespace {
+// The live timeline, buffers of exited threads go back to it.
+std::mutex live_lock;
+Timeline  *live_timeline = nullptr;
+std::atomic<uint64_t> next_timeline_id( 1 );
+}
+
+struct Timeline::BufferOwner {
+    uint64_t timeline_id = 0;
+    Buffer  *buffer = nullptr;
+    ~BufferOwner() { Timeline::releaseBuffer( timeline_id, buffer ); }
+};
+
+Timeline::Timeline(int rank) :
+    rank(rank), id(next_timeline_id++), origin(std::chrono::steady_clock::now()), next_tid(0)
+{
+    std::string fname( "apollo-timeline-rank-" + std::to_string( rank ) + ".json" );
+    fout.open( fname );
+    if( fout.fail() ) {
+        std::cerr << "Error opening timeline file " + fname << std::endl;
+        return;
+    }
+
+    fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    fout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank \
+        << ",\"tid\":0,\"args\":{\"name\":\"apollo rank " << rank << "\"}}";
+
+    std::lock_guard<std::mutex> guard( live_lock );
+    live_timeline = this;
+}
+
+Timeline::~Timeline()
+{
+    {
+        std::lock_guard<std::mutex> guard( live_lock );
+        if( live_timeline == this )
+            live_timeline = nullptr;
+    }
+
+    for(auto &buffer : buffers)
+        flush( *buffer );
+
+    if( fout.is_open() )
+        fout << "\n]}\n";
+}
+
+void
+Timeline::flush(Buffer &buffer)
+{
+    std::lock_guard<std::mutex> guard( file_lock );
+    if( fout.is_open() ) {
+        for(auto &e : buffer.events) {
+            fout << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"apollo\",\"ph\":\"" << e.phase \
+                << "\",\"ts\":" << e.ts \
+                << ",\"pid\":" << rank << ",\"tid\":" << buffer.tid;
+            if( e.phase == 'i' )
+                fout << ",\"s\":\"t\"";
+            if( e.key ) {
+                fout << ",\"args\":{\"" << e.key << "\":";
+                if( e.quoted )
+                    fout << "\"" << escape( e.value ) << "\"";
+                else
+                    fout << e.value;
+                fout << "}";
+            }
+            fout << "}";
+        }
+    }
+    buffer.events.clear();
+}
+
+void
+Timeline::releaseBuffer(uint64_t timeline_id, Buffer *buffer)
+{
+    if( !buffer )
+        return;
+    // Buffers of a destroyed timeline went with it.
+    std::lock_guard<std::mutex> guard( live_lock );
+    if( !live_timeline || live_timeline->id != timeline_id )
+        return;
+    live_timeline->flush( *buffer );
+    std::lock_guard<std::mutex> buffers_guard( live_timeline->buffers_lock );
+    live_timeline->free_buffers.push_back( buffer );
+}
+
+Timeline::Buffer *
+Timeline::getBuffer()
+{
+    thread_local BufferOwner owner;
+    if( owner.timeline_id != id ) {
+        releaseBuffer( owner.timeline_id, owner.buffer );
+        std::lock_guard<std::mutex> guard( buffers_lock );
+        if( free_buffers.empty() ) {
+            buffers.push_back( std::make_unique<Buffer>() );
+            owner.buffer = buffers.back().get();
+        }
+        else {
+            owner.buffer = free_buffers.back();
+            free_buffers.pop_back();
+        }
+        // A reused buffer is a new thread in the trace.
+        owner.buffer->tid = next_tid++;
+        owner.timeline_id = id;
+    }
+    return owner.buffer;
+}
+
+void
+Timeline::record(char phase, const char *name, const char *key, std::string value, bool quoted)
+{
+    int64_t ts = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - origin ).count();
+    Buffer *buffer = getBuffer();
+    buffer->events.push_back( { phase, name, ts, key, std::move( value ), quoted } );
+    if( buffer->events.size() >= flush_events )
+        flush( *buffer );
+}
+
+void
+Timeline::begin(const char *name)
+{
+    record( 'B', name, nullptr, std::string(), false );
+}
+
+void
+Timeline::begin(const char *name, const char *key, const std::string &value)
+{
+    record( 'B', name, key, value, true );
+}
+
+void
+Timeline::begin(const char *name, const char *key, long long value)
+{
+    record( 'B', name, key, std::to_string( value ), false );
+}
+
+void
+Timeline::end(const char *name)
+{
+    record( 'E', name, nullptr, std::string(), false );
+}
+
+void
+Timeline::instant(const char *name, const char *key, const std::string &value)
+{
+    record( 'i', name, key, value, true );
+}
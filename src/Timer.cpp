@@ -0,0 +1,116 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <iostream>
+#include <thread>
+
+#include "apollo/Timer.h"
+
+#ifdef APOLLO_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+Timer::Backend Timer::backend = Timer::STEADY;
+double         Timer::seconds_per_tick = 1e-9;
+
+static bool
+hasInvariantTSC()
+{
+#ifdef APOLLO_HAVE_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if( !__get_cpuid( 0x80000007, &eax, &ebx, &ecx, &edx ) )
+        return false;
+    return ( edx & ( 1 << 8 ) ) != 0;
+#else
+    return false;
+#endif
+}
+
+double
+Timer::calibrateTSC()
+{
+#ifdef APOLLO_HAVE_TSC
+    // Ticks over a ~20ms window of the raw monotonic clock.
+    struct timespec t0, t1;
+    unsigned int aux;
+    clock_gettime( CLOCK_MONOTONIC_RAW, &t0 );
+    tick_t c0 = __rdtscp( &aux );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+    clock_gettime( CLOCK_MONOTONIC_RAW, &t1 );
+    tick_t c1 = __rdtscp( &aux );
+
+    double elapsed = ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_nsec - t0.tv_nsec ) * 1e-9;
+    return elapsed / ( c1 - c0 );
+#else
+    return 0.0;
+#endif
+}
+
+bool
+Timer::init(const std::string &name)
+{
+    if( name == "steady" ) {
+        backend = STEADY;
+        seconds_per_tick = 1e-9;
+    }
+    else if( name == "tsc" ) {
+        if( hasInvariantTSC() ) {
+            backend = TSC;
+            seconds_per_tick = calibrateTSC();
+        }
+        else {
+            std::cerr << "== APOLLO: No invariant TSC, using monotonic_raw timer" << std::endl;
+            backend = MONOTONIC_RAW;
+            seconds_per_tick = 1e-9;
+        }
+    }
+    else if( name == "monotonic_raw" ) {
+        backend = MONOTONIC_RAW;
+        seconds_per_tick = 1e-9;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+const char *
+Timer::name()
+{
+    switch( backend ) {
+        case TSC:           return "tsc";
+        case MONOTONIC_RAW: return "monotonic_raw";
+        default:            return "steady";
+    }
+}
@@ -0,0 +1,246 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "apollo/TraceWriter.h"
+
+namespace {
+// The live writer, rings of exited threads go back to it.
+std::mutex   live_lock;
+TraceWriter *live_writer = nullptr;
+std::atomic<uint64_t> next_writer_id( 1 );
+}
+
+struct TraceWriter::RingOwner {
+    uint64_t writer_id = 0;
+    Ring    *ring = nullptr;
+    ~RingOwner() { TraceWriter::releaseRing( writer_id, ring ); }
+};
+
+TraceWriter::TraceWriter(const std::string &folder, int rank, const std::string &training,
+        bool binary, bool csv) :
+    folder(folder), rank(rank), training(training), binary(binary), csv(csv),
+    id(next_writer_id++), done(false)
+{
+    std::string fname = getBinaryName();
+    fout = fopen( fname.c_str(), "wb" );
+    if( !fout ) {
+        std::cerr << "Error opening trace file " + fname << std::endl;
+        abort();
+    }
+    setvbuf( fout, nullptr, _IOFBF, 1 << 20 );
+
+    writer = std::thread( &TraceWriter::run, this );
+
+    std::lock_guard<std::mutex> guard( live_lock );
+    live_writer = this;
+}
+
+TraceWriter::~TraceWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard( live_lock );
+        if( live_writer == this )
+            live_writer = nullptr;
+    }
+
+    done.store( true );
+    writer.join();
+    drain();
+    fclose( fout );
+
+    if( csv )
+        writeCSV();
+
+    if( !binary ) {
+        std::remove( getBinaryName().c_str() );
+        return;
+    }
+
+    std::ofstream meta( folder + "/trace-rank-" + std::to_string( rank ) + ".meta" );
+    meta << "training " << training << "\n";
+    for(auto &r : regions)
+        meta << r.first << " " << r.second.second << " " << r.second.first << "\n";
+}
+
+std::string
+TraceWriter::getBinaryName() const
+{
+    return folder + "/trace-rank-" + std::to_string( rank ) + ".bin";
+}
+
+bool
+TraceWriter::addRegion(int region_id, const std::string &name, int num_features)
+{
+    if( num_features > APOLLO_TRACE_MAX_FEATURES ) {
+        std::cerr << "== APOLLO: Region " << name << " has more than " << APOLLO_TRACE_MAX_FEATURES \
+            << " features, not in the binary trace" << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> guard( rings_lock );
+    regions.push_back( { region_id, { name, num_features } } );
+    return true;
+}
+
+void
+TraceWriter::writeCSV()
+{
+    // Same files, layout and number formatting as direct CSV tracing.
+    std::map< int, std::unique_ptr<std::ofstream> > outs;
+    for(auto &r : regions) {
+        std::string fname( folder + "/trace-" + training + "-region-" + r.second.first \
+                + "-rank-" + std::to_string( rank ) + ".csv" );
+        std::unique_ptr<std::ofstream> out = std::make_unique<std::ofstream>( fname );
+        if( out->fail() ) {
+            std::cerr << "Error opening trace file " + fname << std::endl;
+            abort();
+        }
+        *out << "rankid training region idx";
+        for(int i = 0; i < r.second.second; i++)
+            *out << " f" << i;
+        *out << " policy xtime\n";
+        outs[ r.first ] = std::move( out );
+    }
+
+    std::map< int, std::string > names;
+    for(auto &r : regions)
+        names[ r.first ] = r.second.first;
+
+    FILE *fin = fopen( getBinaryName().c_str(), "rb" );
+    if( !fin )
+        return;
+    std::vector<TraceRecord> records( ring_size );
+    size_t count;
+    while( ( count = fread( records.data(), sizeof(TraceRecord), records.size(), fin ) ) > 0 ) {
+        for(size_t i = 0; i < count; i++) {
+            const TraceRecord &record = records[i];
+            auto iter = outs.find( record.region_id );
+            if( iter == outs.end() )
+                continue;
+            std::ofstream &out = *iter->second;
+            out << record.rank << " " << training << " " << names[ record.region_id ] << " " \
+                << record.idx << " ";
+            for(int j = 0; j < record.num_features; j++)
+                out << record.features[j] << " ";
+            out << record.policy << " " << record.time << "\n";
+        }
+    }
+    fclose( fin );
+}
+
+void
+TraceWriter::releaseRing(uint64_t writer_id, Ring *ring)
+{
+    if( !ring )
+        return;
+    // Rings of a destroyed writer went with it.
+    std::lock_guard<std::mutex> guard( live_lock );
+    if( !live_writer || live_writer->id != writer_id )
+        return;
+    // Records left in the ring are still drained, the next thread appends
+    // after them.
+    std::lock_guard<std::mutex> rings_guard( live_writer->rings_lock );
+    live_writer->free_rings.push_back( ring );
+}
+
+TraceWriter::Ring *
+TraceWriter::getRing()
+{
+    thread_local RingOwner owner;
+    if( owner.writer_id != id ) {
+        releaseRing( owner.writer_id, owner.ring );
+        std::lock_guard<std::mutex> guard( rings_lock );
+        if( free_rings.empty() ) {
+            rings.push_back( std::make_unique<Ring>() );
+            owner.ring = rings.back().get();
+        }
+        else {
+            owner.ring = free_rings.back();
+            free_rings.pop_back();
+        }
+        owner.writer_id = id;
+    }
+    return owner.ring;
+}
+
+void
+TraceWriter::write(const TraceRecord &record)
+{
+    Ring *ring = getRing();
+
+    size_t head = ring->head.load( std::memory_order_relaxed );
+    // Full, wait for the writer thread to catch up.
+    while( head - ring->tail.load( std::memory_order_acquire ) >= ring_size )
+        std::this_thread::yield();
+
+    ring->records[ head % ring_size ] = record;
+    ring->head.store( head + 1, std::memory_order_release );
+}
+
+size_t
+TraceWriter::drain()
+{
+    std::lock_guard<std::mutex> guard( rings_lock );
+
+    size_t drained = 0;
+    for(auto &ring : rings) {
+        size_t tail = ring->tail.load( std::memory_order_relaxed );
+        size_t head = ring->head.load( std::memory_order_acquire );
+        while( tail < head ) {
+            // Contiguous chunk up to the end of the ring.
+            size_t start = tail % ring_size;
+            size_t count = std::min( head - tail, ring_size - start );
+            fwrite( &ring->records[ start ], sizeof(TraceRecord), count, fout );
+            tail += count;
+            drained += count;
+        }
+        ring->tail.store( tail, std::memory_order_release );
+    }
+
+    return drained;
+}
+
+void
+TraceWriter::run()
+{
+    while( !done.load() ) {
+        if( drain() == 0 )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+}
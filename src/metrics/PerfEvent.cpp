@@ -0,0 +1,160 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "apollo/metrics/PerfEvent.h"
+
+static const struct {
+    const char *name;
+    uint32_t    type;
+    uint64_t    config;
+} perf_events[] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "task-clock",       PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page-faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+static int
+openCounter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Calling thread, any cpu.
+    return syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+bool
+PerfEvent::lookup(const std::string &event, uint32_t &type, uint64_t &config)
+{
+    for(auto &e : perf_events) {
+        if( event == e.name ) {
+            type = e.type;
+            config = e.config;
+            return true;
+        }
+    }
+    return false;
+}
+
+PerfEvent::PerfEvent(uint32_t type, uint64_t config, const std::string &event) :
+    MetricProvider("perf:" + event), type(type), config(config)
+{
+    // Probe on the creating thread to fall back early and warn once.
+    int fd = openCounter( type, config );
+    if( fd < 0 && type != PERF_TYPE_SOFTWARE ) {
+        std::cerr << "== APOLLO: Cannot open perf event " << event \
+            << " (" << strerror( errno ) << "), using task-clock" << std::endl;
+        this->type = PERF_TYPE_SOFTWARE;
+        this->config = PERF_COUNT_SW_TASK_CLOCK;
+        name = "perf:task-clock";
+        fd = openCounter( this->type, this->config );
+    }
+    if( fd < 0 ) {
+        std::cerr << "== APOLLO: Cannot open perf event " << name \
+            << " (" << strerror( errno ) << ")" << std::endl;
+        abort();
+    }
+    close( fd );
+}
+
+PerfEvent::~PerfEvent()
+{
+}
+
+// Counters of a thread, closed when the thread exits.
+struct PerfThreadCounters {
+    std::map< std::pair<uint32_t, uint64_t>, int > fds;
+    ~PerfThreadCounters() {
+        for(auto &fd : fds)
+            close( fd.second );
+    }
+};
+
+int
+PerfEvent::getFd()
+{
+    thread_local PerfThreadCounters counters;
+    auto iter = counters.fds.find( { type, config } );
+    if( iter == counters.fds.end() ) {
+        int fd = openCounter( type, config );
+        if( fd < 0 ) {
+            // Mixing events across threads would mix units, abort as the
+            // constructor does.
+            std::cerr << "== APOLLO: Cannot open perf event " << name \
+                << " on thread (" << strerror( errno ) << ")" << std::endl;
+            abort();
+        }
+        iter = counters.fds.insert( { { type, config }, fd } ).first;
+    }
+    return iter->second;
+}
+
+double
+PerfEvent::start()
+{
+    uint64_t count = 0;
+    if( read( getFd(), &count, sizeof(count) ) != sizeof(count) )
+        return 0.0;
+    return count;
+}
+
+double
+PerfEvent::stop(double start)
+{
+    uint64_t count = 0;
+    if( read( getFd(), &count, sizeof(count) ) != sizeof(count) )
+        return 0.0;
+    return count - start;
+}
@@ -0,0 +1,198 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+#include "apollo/models/Bandit.h"
+
+void
+Bandit::init(size_t num_features)
+{
+    dim = num_features + 1;
+    x.assign( dim, 0.0 );
+    tmp.assign( dim, 0.0 );
+    arms.resize( policy_count );
+    for(auto &arm : arms) {
+        // Ridge prior: A = I.
+        arm.A_inv.assign( dim * dim, 0.0 );
+        for(size_t i = 0; i < dim; i++)
+            arm.A_inv[ i * dim + i ] = 1.0;
+        arm.b.assign( dim, 0.0 );
+        arm.theta.assign( dim, 0.0 );
+    }
+}
+
+void
+Bandit::context(const std::vector<float> &features)
+{
+    if( arms.empty() )
+        init( features.size() );
+
+    // Features are typically problem sizes spanning orders of magnitude,
+    // compress them so the ridge regression stays well conditioned.
+    x[0] = 1.0;
+    for(size_t i = 1; i < dim; i++) {
+        double f = ( i - 1 < features.size() ) ? features[ i - 1 ] : 0.0;
+        x[i] = std::copysign( std::log2( 1.0 + std::fabs( f ) ), f );
+    }
+}
+
+int
+Bandit::getIndex(std::vector<float> &features)
+{
+    context( features );
+
+    int choice = 0;
+    double best = -std::numeric_limits<double>::infinity();
+    for(int p = 0; p < policy_count; p++) {
+        Arm &arm = arms[ p ];
+        double mean = 0.0, width = 0.0;
+        for(size_t i = 0; i < dim; i++) {
+            mean += arm.theta[ i ] * x[ i ];
+            double row = 0.0;
+            for(size_t j = 0; j < dim; j++)
+                row += arm.A_inv[ i * dim + j ] * x[ j ];
+            width += x[ i ] * row;
+        }
+        double ucb = mean + alpha * std::sqrt( std::max( width, 0.0 ) );
+        if( ucb > best ) {
+            best = ucb;
+            choice = p;
+        }
+    }
+
+    return choice;
+}
+
+void
+Bandit::update(std::vector<float> &features, int policy, double metric)
+{
+    context( features );
+
+    if( metric_scale <= 0.0 )
+        metric_scale = ( metric > 0.0 ) ? metric : 1.0;
+    double reward = -std::log1p( std::max( metric, 0.0 ) / metric_scale );
+
+    Arm &arm = arms[ policy ];
+
+    // Sherman-Morrison rank-one update of A_inv for A += x x^T.
+    double denom = 1.0;
+    for(size_t i = 0; i < dim; i++) {
+        tmp[ i ] = 0.0;
+        for(size_t j = 0; j < dim; j++)
+            tmp[ i ] += arm.A_inv[ i * dim + j ] * x[ j ];
+        denom += x[ i ] * tmp[ i ];
+    }
+    for(size_t i = 0; i < dim; i++)
+        for(size_t j = 0; j < dim; j++)
+            arm.A_inv[ i * dim + j ] -= ( tmp[ i ] * tmp[ j ] ) / denom;
+
+    for(size_t i = 0; i < dim; i++)
+        arm.b[ i ] += reward * x[ i ];
+
+    for(size_t i = 0; i < dim; i++) {
+        arm.theta[ i ] = 0.0;
+        for(size_t j = 0; j < dim; j++)
+            arm.theta[ i ] += arm.A_inv[ i * dim + j ] * arm.b[ j ];
+    }
+}
+
+Bandit::Bandit(int num_policies, float alpha)
+    : PolicyModel(num_policies, "Bandit", false),
+      dim(0),
+      alpha(alpha),
+      metric_scale(0.0)
+{
+    return;
+}
+
+Bandit::Bandit(int num_policies, float alpha, const std::string &path)
+    : Bandit(num_policies, alpha)
+{
+    std::ifstream fin( path );
+    std::string tag;
+    int num_arms;
+    fin >> tag >> num_arms >> dim >> metric_scale;
+    if( !fin.good() || tag != "Bandit" || num_arms != policy_count || dim < 1 ) {
+        std::cerr << "== APOLLO: Cannot load the Bandit model " << path \
+            << " for " << policy_count << " policies" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    init( dim - 1 );
+    for(auto &arm : arms) {
+        for(auto &a : arm.A_inv)
+            fin >> a;
+        for(auto &b : arm.b)
+            fin >> b;
+        for(size_t i = 0; i < dim; i++) {
+            arm.theta[ i ] = 0.0;
+            for(size_t j = 0; j < dim; j++)
+                arm.theta[ i ] += arm.A_inv[ i * dim + j ] * arm.b[ j ];
+        }
+    }
+    if( fin.fail() ) {
+        std::cerr << "== APOLLO: Truncated Bandit model " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+Bandit::~Bandit()
+{
+    return;
+}
+
+void
+Bandit::store(const std::string &filename)
+{
+    // Nothing learned before the first update.
+    if( arms.empty() )
+        return;
+    std::ofstream fout( filename );
+    fout << std::setprecision( std::numeric_limits<double>::max_digits10 );
+    fout << "Bandit " << policy_count << " " << dim << " " << metric_scale << "\n";
+    for(auto &arm : arms) {
+        for(auto &a : arm.A_inv)
+            fout << a << " ";
+        for(auto &b : arm.b)
+            fout << b << " ";
+        fout << "\n";
+    }
+}
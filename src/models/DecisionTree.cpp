@@ -180,6 +180,17 @@ DecisionTree::getIndex(std::vector<float> &features)
 
 }
 
+void
+DecisionTree::getIndexBatch(const float *features, int num_rows, int num_features, int *policies)
+{
+    // One predict call traverses the forest for the whole block.
+    Mat fmat( num_rows, num_features, CV_32F, const_cast<float *>( features ) );
+    Mat results;
+    dtree->predict( fmat, results );
+    for(int i = 0; i < num_rows; i++)
+        policies[i] = static_cast<int>( results.at<float>( i, 0 ) );
+}
+
 void DecisionTree::store(const std::string &filename)
 {
     dtree->save( filename );
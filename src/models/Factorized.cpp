@@ -0,0 +1,205 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+
+#include "apollo/models/Factorized.h"
+
+static int
+product(const std::vector<int> &knobs)
+{
+    return std::accumulate( knobs.begin(), knobs.end(), 1, std::multiplies<int>() );
+}
+
+int
+Factorized::encode(const std::vector<int> &choices) const
+{
+    int policy = 0;
+    for(size_t k = 0; k < knobs.size(); k++)
+        policy = policy * knobs[k] + choices[k];
+    return policy;
+}
+
+void
+Factorized::decode(int policy, std::vector<int> &choices) const
+{
+    choices.resize( knobs.size() );
+    for(size_t k = knobs.size(); k-- > 0; ) {
+        choices[k] = policy % knobs[k];
+        policy /= knobs[k];
+    }
+}
+
+void
+Factorized::nextKnob(Sweep &sweep, int from)
+{
+    // Single valued knobs need no exploration.
+    for(size_t k = from; k < knobs.size(); k++) {
+        if( knobs[k] > 1 ) {
+            sweep.knob = k;
+            sweep.next = 0;
+            sweep.stats.clear();
+            sweep.stats.resize( knobs[k] );
+            return;
+        }
+    }
+
+    sweep.pass++;
+    if( sweep.pass < passes && from > 0 )
+        nextKnob( sweep, 0 );
+    else
+        sweep.done = true;
+}
+
+void
+Factorized::settle(Sweep &sweep, int from)
+{
+    nextKnob( sweep, from );
+    if( sweep.done )
+        open_sweeps--;
+}
+
+Factorized::Sweep &
+Factorized::getSweep(const std::vector<float> &features)
+{
+    auto iter = sweeps.find( features );
+    if( iter == sweeps.end() ) {
+        Sweep sweep;
+        sweep.best.assign( knobs.size(), 0 );
+        sweep.pass = 0;
+        sweep.done = false;
+        open_sweeps++;
+        settle( sweep, 0 );
+        iter = sweeps.emplace( features, std::move( sweep ) ).first;
+    }
+    return iter->second;
+}
+
+int
+Factorized::getIndex(std::vector<float> &features)
+{
+    Sweep &sweep = getSweep( features );
+
+    if( sweep.done )
+        return encode( sweep.best );
+
+    // Cycle over the values of the knob short of samples.
+    int size = knobs[ sweep.knob ];
+    int value = sweep.next;
+    for(int i = 0; i < size; i++) {
+        int v = ( sweep.next + i ) % size;
+        if( sweep.stats[ v ].exec_count < min_samples ) {
+            value = v;
+            break;
+        }
+    }
+    sweep.next = ( value + 1 ) % size;
+
+    choices = sweep.best;
+    choices[ sweep.knob ] = value;
+    return encode( choices );
+}
+
+void
+Factorized::update(std::vector<float> &features, int policy, double metric)
+{
+    Sweep &sweep = getSweep( features );
+
+    if( sweep.done )
+        return;
+
+    // Only executions varying the explored knob alone count.
+    decode( policy, choices );
+    for(size_t k = 0; k < knobs.size(); k++)
+        if( static_cast<int>( k ) != sweep.knob && choices[k] != sweep.best[k] )
+            return;
+
+    sweep.stats[ choices[ sweep.knob ] ].add( metric );
+
+    int best = 0;
+    for(int v = 0; v < knobs[ sweep.knob ]; v++) {
+        if( sweep.stats[ v ].exec_count < min_samples )
+            return;
+        if( sweep.stats[ v ].time_mean < sweep.stats[ best ].time_mean )
+            best = v;
+    }
+
+    sweep.best[ sweep.knob ] = best;
+    settle( sweep, sweep.knob + 1 );
+}
+
+Factorized::Factorized(
+        const std::vector<int> &knobs,
+        int min_samples,
+        int passes)
+    : PolicyModel(product(knobs), "Factorized", true),
+      knobs(knobs),
+      min_samples( std::max( min_samples, 1 ) ),
+      passes( std::max( passes, 1 ) ),
+      open_sweeps(0)
+{
+    return;
+}
+
+Factorized::~Factorized()
+{
+    return;
+}
+
+void
+Factorized::store(const std::string &filename)
+{
+    // One line per feature vector: features, settled flag, best tuple.
+    std::ofstream fout( filename );
+    fout << std::setprecision( std::numeric_limits<float>::max_digits10 );
+    fout << "Factorized " << knobs.size();
+    for(auto k : knobs)
+        fout << " " << k;
+    fout << "\n" << sweeps.size() << "\n";
+    for(auto &it : sweeps) {
+        fout << it.first.size();
+        for(auto f : it.first)
+            fout << " " << f;
+        fout << " " << it.second.done;
+        for(auto b : it.second.best)
+            fout << " " << b;
+        fout << "\n";
+    }
+}
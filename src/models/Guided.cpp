@@ -0,0 +1,104 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <string>
+#include <limits>
+#include <algorithm>
+
+#include "apollo/models/Guided.h"
+
+Guided::Candidates &
+Guided::getCandidates(const std::vector<float> &features)
+{
+    auto iter = candidates.find( features );
+    if( iter != candidates.end() )
+        return iter->second;
+
+    Candidates c;
+    c.next = 0;
+
+    if( time_model ) {
+        // Same layout as the timing model training data: features, policy.
+        std::vector<float> feature_vector = features;
+        feature_vector.push_back( 0 );
+
+        std::vector<double> time_pred( policy_count );
+        double best = std::numeric_limits<double>::max();
+        for(int p = 0; p < policy_count; p++) {
+            feature_vector.back() = p;
+            time_pred[ p ] = time_model->getTimePrediction( feature_vector );
+            best = std::min( best, time_pred[ p ] );
+        }
+
+        for(int p = 0; p < policy_count; p++) {
+            if( time_pred[ p ] <= threshold * best )
+                c.policies.push_back( p );
+        }
+    }
+
+    // No usable prediction, explore everything.
+    if( c.policies.empty() ) {
+        for(int p = 0; p < policy_count; p++)
+            c.policies.push_back( p );
+    }
+
+    return candidates.insert( { features, c } ).first->second;
+}
+
+int
+Guided::getIndex(std::vector<float> &features)
+{
+    Candidates &c = getCandidates( features );
+
+    int choice = c.policies[ c.next ];
+    c.next = ( c.next + 1 ) % c.policies.size();
+
+    return choice;
+}
+
+Guided::Guided(
+        int   num_policies,
+        std::shared_ptr<TimingModel> time_model,
+        float threshold)
+    : PolicyModel(num_policies, "Guided", true),
+      time_model(time_model),
+      threshold(threshold)
+{
+    return;
+}
+
+Guided::~Guided()
+{
+    return;
+}
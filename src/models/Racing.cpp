@@ -0,0 +1,152 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <string>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <utility>
+
+#include "apollo/models/Racing.h"
+
+Racing::Race &
+Racing::getRace(const std::vector<float> &features)
+{
+    auto iter = races.find( features );
+    if( iter == races.end() ) {
+        Race race;
+        race.stats.resize( policy_count );
+        race.alive.assign( policy_count, true );
+        race.next = 0;
+        race.winner = ( policy_count > 1 ) ? -1 : 0;
+        if( race.winner < 0 ) {
+            open_races++;
+            training = true;
+        }
+        iter = races.emplace( features, std::move( race ) ).first;
+    }
+    return iter->second;
+}
+
+int
+Racing::getIndex(std::vector<float> &features)
+{
+    Race &race = getRace( features );
+
+    if( race.winner >= 0 )
+        return race.winner;
+
+    // Cycle over the policies still in the race.
+    int choice = race.next;
+    while( !race.alive[ choice ] )
+        choice = ( choice + 1 ) % policy_count;
+    race.next = ( choice + 1 ) % policy_count;
+
+    return choice;
+}
+
+void
+Racing::update(std::vector<float> &features, int policy, double metric)
+{
+    Race &race = getRace( features );
+
+    if( race.winner >= 0 || !race.alive[ policy ] )
+        return;
+
+    race.stats[ policy ].add( metric );
+    eliminate( race );
+}
+
+void
+Racing::eliminate(Race &race)
+{
+    // Wait until every surviving policy has enough samples for a
+    // meaningful variance estimate.
+    int leader = -1;
+    for(int i = 0; i < policy_count; i++) {
+        if( !race.alive[ i ] )
+            continue;
+        if( race.stats[ i ].exec_count < min_samples )
+            return;
+        if( leader < 0 || race.stats[ i ].time_mean < race.stats[ leader ].time_mean )
+            leader = i;
+    }
+
+    auto halfwidth = [this](const Apollo::Region::Measure &m) {
+        return confidence * std::sqrt( m.variance() / m.exec_count );
+    };
+
+    double leader_upper = race.stats[ leader ].time_mean + halfwidth( race.stats[ leader ] );
+
+    int num_alive = 0;
+    bool capped = ( max_samples > 0 );
+    for(int i = 0; i < policy_count; i++) {
+        if( !race.alive[ i ] || i == leader )
+            continue;
+        double lower = race.stats[ i ].time_mean - halfwidth( race.stats[ i ] );
+        if( lower > leader_upper )
+            race.alive[ i ] = false;
+        else {
+            num_alive++;
+            capped = capped && race.stats[ i ].exec_count >= max_samples;
+        }
+    }
+
+    // Policies still overlapping after max_samples each are within noise
+    // of the leader, any of them will do.
+    if( num_alive == 0 || ( capped && race.stats[ leader ].exec_count >= max_samples ) ) {
+        race.winner = leader;
+        open_races--;
+        training = ( open_races > 0 );
+    }
+}
+
+Racing::Racing(
+        int   num_policies,
+        float confidence,
+        int   min_samples,
+        int   max_samples)
+    : PolicyModel(num_policies, "Racing", true),
+      confidence(confidence),
+      min_samples( std::max( min_samples, 2 ) ),
+      max_samples( max_samples > 0 ? std::max( max_samples, this->min_samples ) : 0 ),
+      open_races(0)
+{
+    return;
+}
+
+Racing::~Racing()
+{
+    return;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+
+import argparse
+import glob
+import os
+import struct
+
+# Must match TraceRecord in include/apollo/TraceWriter.h.
+MAX_FEATURES = 8
+RECORD = struct.Struct('<iiqii%dfd'%(MAX_FEATURES))
+
+
+def read_meta(fname):
+    training = None
+    regions = {}
+    with open(fname) as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('training '):
+                training = line[len('training '):]
+                continue
+            rid, nfeatures, name = line.split(' ', 2)
+            if int(nfeatures) > MAX_FEATURES:
+                raise ValueError('%s: region %s has %s features, records hold %d'
+                                 %(fname, name, nfeatures, MAX_FEATURES))
+            regions[int(rid)] = (name, int(nfeatures))
+    return training, regions
+
+
+def convert(meta, outdir):
+    training, regions = read_meta(meta)
+    binfile = meta[:-len('.meta')] + '.bin'
+    rank = int(meta[:-len('.meta')].rsplit('-', 1)[1])
+
+    outs = {}
+    with open(binfile, 'rb') as f:
+        while True:
+            buf = f.read(RECORD.size)
+            if len(buf) < RECORD.size:
+                break
+            r = RECORD.unpack(buf)
+            rankid, rid, idx, policy, nfeatures = r[:5]
+            features, xtime = r[5:5+nfeatures], r[5+MAX_FEATURES]
+            if rid not in outs:
+                name, n = regions[rid]
+                fname = '%s/trace-%s-region-%s-rank-%d.csv'%(outdir, training, name, rank)
+                out = open(fname, 'w')
+                out.write('rankid training region idx')
+                out.write(''.join(' f%d'%(i) for i in range(n)))
+                out.write(' policy xtime\n')
+                outs[rid] = out
+            out = outs[rid]
+            out.write('%d %s %s %d '%(rankid, training, regions[rid][0], idx))
+            out.write(''.join('%g '%(x) for x in features))
+            out.write('%d %g\n'%(policy, xtime))
+
+    for out in outs.values():
+        out.close()
+    print('Converted %s to %d region csv files'%(binfile, len(outs)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert APOLLO_TRACE_BINARY traces to csv.')
+    parser.add_argument('-d', '--dir', help='the directory that contains the trace files.', required=True)
+    parser.add_argument('-o', '--outdir', help='the output directory (default: --dir).')
+    args = parser.parse_args()
+
+    outdir = args.outdir if args.outdir else args.dir
+    os.makedirs(outdir, exist_ok=True)
+    for meta in sorted(glob.glob('%s/trace-rank-*.meta'%(args.dir))):
+        convert(meta, outdir)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,88 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "apollo/Apollo.h"
+#include "apollo/ParallelFor.h"
+#include "mpi.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if( !( cond ) ) { \
+            fprintf(stdout, "FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+int main()
+{
+    // RoundRobin visits every offered policy.
+    setenv( "APOLLO_INIT_MODEL", "RoundRobin", 1 );
+
+    MPI_Init(NULL, NULL);
+    Apollo::instance();
+
+    const int n = 1000;
+    std::vector<int> a( n );
+    apollo::ParallelFor &loop = apollo::getParallelFor( "parallel-for-test" );
+
+    // Without OpenMP only the distinct serial policies are offered.
+#ifdef _OPENMP
+    CHECK( loop.getAvailable() == apollo::ParallelFor::num_policies );
+#else
+    CHECK( loop.getAvailable() == apollo::ParallelFor::num_serial );
+#endif
+    CHECK( loop.getRegion()->model->policy_count == loop.getAvailable() );
+
+    // Every policy runs every iteration once.
+    for(int call = 0; call < 3 * loop.getAvailable(); call++) {
+        apollo::parallel_for( "parallel-for-test", 0, n, [&](int i) { a[i] += i; } );
+        int wrong = 0;
+        for(int i = 0; i < n; i++)
+            wrong += ( a[i] != ( call + 1 ) * i );
+        CHECK( wrong == 0 );
+    }
+    CHECK( loop.getRegion()->executions == 3 * loop.getAvailable() );
+
+    fprintf(stdout, "%s, %d failures.\n", failures ? "FAILED" : "passed", failures);
+
+    MPI_Finalize();
+
+    return failures ? 1 : 0;
+}
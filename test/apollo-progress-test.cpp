@@ -0,0 +1,152 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "apollo/Apollo.h"
+#include "apollo/Region.h"
+#include "mpi.h"
+
+// Concurrent collection: a progress thread and completing threads collect
+// while the application begins, ends, flushes and creates regions.  Build
+// with -fsanitize=thread to check for data races.
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if( !( cond ) ) { \
+            fprintf(stdout, "FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+static void spin(int n)
+{
+    volatile double x = 0.0;
+    for(int k = 0; k < n; k++)
+        x += k;
+}
+
+static void testProgress(Apollo *apollo)
+{
+    const int num_execs = 2000;
+    Apollo::Region *region = new Apollo::Region( 1, "progress-sync", 2 );
+
+    // Contexts completed on worker threads, collected by the progress
+    // thread while the application keeps running the region.
+    std::vector<Apollo::RegionContext *> contexts;
+    for(int i = 0; i < num_execs; i++) {
+        Apollo::RegionContext *context = region->begin();
+        region->setFeature( context, float( i % 4 ) );
+        region->getPolicyIndex( context );
+        contexts.push_back( context );
+    }
+    std::vector<std::thread> workers;
+    for(int t = 0; t < 4; t++) {
+        workers.emplace_back( [region, &contexts, t]() {
+            for(size_t i = t; i < contexts.size(); i += 4) {
+                spin( 100 );
+                region->complete( contexts[i] );
+            }
+        } );
+    }
+    for(int i = 0; i < num_execs; i++) {
+        Apollo::RegionContext *context = region->begin( { float( i % 4 ) } );
+        spin( 100 * ( region->getPolicyIndex( context ) + 1 ) );
+        region->end( context );
+        if( i == num_execs / 2 )
+            apollo->flushAllRegionMeasurements( i );
+    }
+    for(auto &w : workers)
+        w.join();
+
+    // Regions created and destroyed while collectors run.
+    for(int i = 0; i < 10; i++) {
+        Apollo::Region *other = new Apollo::Region( 1, "progress-other", 2 );
+        Apollo::RegionContext *context = other->begin( { 1.0f } );
+        other->getPolicyIndex( context );
+        other->end( context );
+        delete other;
+    }
+
+    apollo->progress();
+    CHECK( region->executions == 2 * num_execs );
+}
+
+static void testAsync(Apollo *apollo)
+{
+    const int num_execs = 400;
+    Apollo::Region *region = new Apollo::Region( 1, "progress-async", 2 );
+    // Unsampled executions end on the completing thread.
+    region->setSampleRate( 3 );
+
+    std::vector<std::future<int>> futures;
+    for(int i = 0; i < num_execs; i++)
+        futures.push_back( region->launchAsync( { float( i % 2 ) }, [](int policy) {
+                    spin( 100 * ( policy + 1 ) );
+                    return policy; } ) );
+    for(int i = 0; i < num_execs; i++) {
+        Apollo::RegionContext *context = region->begin( { 2.0f } );
+        region->getPolicyIndex( context );
+        region->end( context );
+    }
+    for(auto &f : futures)
+        f.get();
+
+    apollo->progress();
+    CHECK( region->executions == 2 * num_execs );
+}
+
+int main()
+{
+    setenv( "APOLLO_PROGRESS_THREAD", "1", 1 );
+    setenv( "APOLLO_FLUSH_PERIOD", "500", 1 );
+    setenv( "APOLLO_INIT_MODEL", "RoundRobin", 1 );
+
+    MPI_Init(NULL, NULL);
+    Apollo *apollo = Apollo::instance();
+
+    testProgress( apollo );
+    testAsync( apollo );
+
+    fprintf(stdout, "%s, %d failures.\n", failures ? "FAILED" : "passed", failures);
+
+    MPI_Finalize();
+
+    return failures ? 1 : 0;
+}
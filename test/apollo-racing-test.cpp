@@ -0,0 +1,297 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "apollo/Apollo.h"
+#include "apollo/ParameterTuner.h"
+#include "apollo/Region.h"
+#include "apollo/models/Bandit.h"
+#include "apollo/models/Factorized.h"
+#include "apollo/models/Racing.h"
+#include "mpi.h"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if( !( cond ) ) { \
+            fprintf(stdout, "FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while(0)
+
+static bool near(double a, double b)
+{
+    return std::fabs( a - b ) <= 1e-9 * std::max( 1.0, std::fabs( b ) );
+}
+
+static void testWelford()
+{
+    std::vector<double> samples = { 3.0, 1.5, 4.25, 1e-3, 2.0, 7.5, 3.0 };
+
+    Apollo::Region::Measure m;
+    double sum = 0.0;
+    for(auto t : samples) {
+        m.add( t );
+        sum += t;
+    }
+    double mean = sum / samples.size();
+    double ss = 0.0;
+    for(auto t : samples)
+        ss += ( t - mean ) * ( t - mean );
+
+    CHECK( m.exec_count == (int)samples.size() );
+    CHECK( near( m.time_mean, mean ) );
+    CHECK( near( m.time_total, sum ) );
+    CHECK( near( m.variance(), ss / ( samples.size() - 1 ) ) );
+
+    // An integer weight counts as that many repeated samples.
+    Apollo::Region::Measure weighted, repeated;
+    for(auto t : samples) {
+        weighted.add( t, 3.0 );
+        for(int i = 0; i < 3; i++)
+            repeated.add( t );
+    }
+    CHECK( near( weighted.time_mean, repeated.time_mean ) );
+    CHECK( near( weighted.variance(), repeated.variance() ) );
+
+    // Decay scales the weight of past samples, not their mean.
+    weighted.decay( 0.5 );
+    CHECK( near( weighted.time_mean, repeated.time_mean ) );
+    CHECK( near( weighted.weight, 0.5 * repeated.weight ) );
+
+    Apollo::Region::Measure single;
+    single.add( 5.0 );
+    CHECK( single.variance() == 0.0 );
+}
+
+// Runs the race of one feature vector, policy p measuring means[p] with a
+// small deterministic jitter alternating per pair of executions.  Returns the number of executions.
+static int race(Racing &model, std::vector<float> features,
+        const std::vector<double> &means, double jitter, int max_execs)
+{
+    int execs = 0;
+    while( model.training && execs < max_execs ) {
+        int policy = model.getIndex( features );
+        double metric = means[ policy ] + ( ( ( execs / 2 ) % 2 ) ? jitter : -jitter );
+        model.update( features, policy, metric );
+        execs++;
+    }
+    return execs;
+}
+
+static void testRacing()
+{
+    // Clear winner: the race closes with policy 1.
+    Racing model( 3, 1.96, 3, 0 );
+    CHECK( model.keepAtFlush() );
+    std::vector<float> a = { 1.0f };
+    int execs = race( model, a, { 2.0, 1.0, 3.0 }, 0.01, 1000 );
+    CHECK( !model.training );
+    CHECK( execs < 1000 );
+    for(int i = 0; i < 5; i++)
+        CHECK( model.getIndex( a ) == 1 );
+
+    // A new feature vector reopens training until its own race closes.
+    std::vector<float> b = { 2.0f };
+    model.getIndex( b );
+    CHECK( model.training );
+    race( model, b, { 1.0, 4.0, 4.0 }, 0.01, 1000 );
+    CHECK( !model.training );
+    CHECK( model.getIndex( b ) == 0 );
+    CHECK( model.getIndex( a ) == 1 );
+
+    // Overlapping intervals keep both policies alive until max_samples.
+    Racing tie( 2, 1.96, 3, 20 );
+    std::vector<float> c = { 3.0f };
+    race( tie, c, { 1.0, 1.0 }, 0.5, 30 );
+    CHECK( tie.training );
+    int execs_tie = race( tie, c, { 1.0, 1.0 }, 0.5, 1000 );
+    CHECK( !tie.training );
+    CHECK( 30 + execs_tie == 2 * 20 );
+    int settled = tie.getIndex( c );
+    CHECK( settled == 0 || settled == 1 );
+    CHECK( tie.getIndex( c ) == settled );
+
+    // Without a cap a tie races until separation.
+    Racing uncapped( 2, 1.96, 3, 0 );
+    race( uncapped, c, { 1.0, 1.0 }, 0.5, 1000 );
+    CHECK( uncapped.training );
+
+    // Eliminated policies are no longer explored.
+    Racing slow( 3, 1.96, 3, 0 );
+    std::vector<float> d = { 4.0f };
+    std::vector<double> means = { 1.0, 1.05, 100.0 };
+    for(int i = 0; i < 30; i++) {
+        int policy = slow.getIndex( d );
+        slow.update( d, policy, means[ policy ] + ( ( i % 2 ) ? 0.2 : -0.2 ) );
+    }
+    int explored_slowest = 0;
+    for(int i = 0; i < 10; i++) {
+        int policy = slow.getIndex( d );
+        explored_slowest += ( policy == 2 );
+        slow.update( d, policy, means[ policy ] + ( ( i % 2 ) ? 0.2 : -0.2 ) );
+    }
+    CHECK( explored_slowest == 0 );
+}
+
+// Trains on two sizes with different fastest policies, returns how many of
+// the last 100 choices of each size were its fastest.
+static int train(Bandit &model, int rounds)
+{
+    std::vector<float> small = { 16.0f }, large = { 65536.0f };
+    std::vector<double> small_means = { 1.0, 3.0, 3.0 }, large_means = { 9.0, 6.0, 2.0 };
+    int best = 0;
+    for(int i = 0; i < rounds; i++) {
+        int policy = model.getIndex( small );
+        model.update( small, policy, small_means[ policy ] + ( ( i % 2 ) ? 0.1 : -0.1 ) );
+        best += ( i >= rounds - 100 && policy == 0 );
+        policy = model.getIndex( large );
+        model.update( large, policy, large_means[ policy ] + ( ( i % 2 ) ? 0.1 : -0.1 ) );
+        best += ( i >= rounds - 100 && policy == 2 );
+    }
+    return best;
+}
+
+static void testBandit()
+{
+    // Converges to the fastest policy of each size.
+    Bandit model( 3, 1.0 );
+    CHECK( model.keepAtFlush() );
+    CHECK( train( model, 500 ) >= 190 );
+
+    // A stored model resumes with the same choices.
+    std::string path = "apollo-racing-test-bandit.txt";
+    model.store( path );
+    Bandit loaded( 3, 1.0, path );
+    std::remove( path.c_str() );
+    for(float f : { 16.0f, 256.0f, 4096.0f, 65536.0f }) {
+        std::vector<float> features = { f };
+        CHECK( loaded.getIndex( features ) == model.getIndex( features ) );
+    }
+    std::vector<float> small = { 16.0f }, large = { 65536.0f };
+    CHECK( loaded.getIndex( small ) == 0 );
+    CHECK( loaded.getIndex( large ) == 2 );
+}
+
+static void testParameterTuner()
+{
+    // Successive halving of 8 candidates from 2 samples closes after
+    // 8 x 2 + 4 x 2 + 2 x 4 executions, counts carry over between rungs,
+    // on the candidate closest to 70.
+    ParameterTuner tuner( 8, 2 );
+    CHECK( tuner.add( { "tile", 0.0, 100.0, true, false } ) == 0 );
+    std::vector<float> a = { 1.0f };
+    int execs = 0;
+    do {
+        int candidate = tuner.select( a, true );
+        double v = tuner.values( a, candidate )[0];
+        tuner.update( a, candidate, 1.0 + std::fabs( v - 70.0 ) + ( ( execs % 2 ) ? 0.1 : -0.1 ) );
+        execs++;
+    } while( tuner.searching() && execs < 1000 );
+    CHECK( execs == 32 );
+    double best = tuner.values( a, 0 )[0];
+    for(int i = 1; i < 8; i++) {
+        double v = tuner.values( a, i )[0];
+        if( std::fabs( v - 70.0 ) < std::fabs( best - 70.0 ) )
+            best = v;
+    }
+    double leader = tuner.values( a, tuner.select( a, true ) )[0];
+    CHECK( leader == best );
+
+    // Leaders load back exactly and final.
+    std::vector<float> b = { 0.1f };
+    tuner.values( b, tuner.select( b, false ) );
+    std::string path = "apollo-racing-test.params";
+    tuner.store( path );
+    ParameterTuner loaded( 8, 2 );
+    CHECK( loaded.load( path ) );
+    std::remove( path.c_str() );
+    CHECK( loaded.size() == 1 );
+    CHECK( !loaded.searching() );
+    CHECK( loaded.values( a, loaded.select( a, true ) )[0] == leader );
+    CHECK( loaded.values( b, loaded.select( b, true ) )[0] == tuner.values( b, tuner.select( b, false ) )[0] );
+    // Unsearched vectors take the nearest leader.
+    CHECK( loaded.nearest( { 0.9f } )[0] == leader );
+    CHECK( loaded.add( { "tile", 0.0, 100.0, true, false } ) == 0 );
+}
+
+static void testFactorized()
+{
+    // One pass over knobs of 4, 3 and 5 values with 3 samples each settles
+    // within ( 4 + 3 + 5 ) x 3 executions on the separable optimum.
+    Factorized model( { 4, 3, 5 }, 3, 1 );
+    std::vector<float> a = { 1.0f };
+    std::vector<int> target = { 2, 1, 3 };
+    int execs = 0;
+    do {
+        int policy = model.getIndex( a );
+        int choices[3] = { policy / 15, ( policy / 5 ) % 3, policy % 5 };
+        double metric = 1.0;
+        for(int k = 0; k < 3; k++)
+            metric += std::abs( choices[k] - target[k] ) + ( ( execs % 2 ) ? 0.1 : -0.1 );
+        model.update( a, policy, metric );
+        execs++;
+    } while( model.keepAtFlush() && execs < 1000 );
+    CHECK( execs <= ( 4 + 3 + 5 ) * 3 );
+    CHECK( model.getIndex( a ) == 2 * 15 + 1 * 5 + 3 );
+    // Settled, the next flush replaces it by a DecisionTree.
+    CHECK( model.training );
+
+    // An unseen vector reopens a sweep and keeps the model until it settles.
+    std::vector<float> b = { 2.0f };
+    model.getIndex( b );
+    CHECK( model.keepAtFlush() );
+}
+
+int main()
+{
+    MPI_Init(NULL, NULL);
+
+    testWelford();
+    testRacing();
+    testBandit();
+    testParameterTuner();
+    testFactorized();
+
+    fprintf(stdout, "%s, %d failures.\n", failures ? "FAILED" : "passed", failures);
+
+    MPI_Finalize();
+
+    return failures ? 1 : 0;
+}
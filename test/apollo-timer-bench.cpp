@@ -0,0 +1,88 @@
+
+// Copyright (c) 2019, Lawrence Livermore National Security, LLC.
+// Produced at the Lawrence Livermore National Laboratory
+//
+// This file is part of Apollo.
+// OCEC-17-092
+// All rights reserved.
+//
+// Apollo is currently developed by Chad Wood, wood67@llnl.gov, with the help
+// of many collaborators.
+//
+// Apollo was originally created by David Beckingsale, david@llnl.gov
+//
+// For details, see https://github.com/LLNL/apollo.
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+// Per-call overhead of each timer backend, alone and as seen by an empty
+// region begin/getPolicyIndex/end cycle.
+
+#include <cstdio>
+#include <chrono>
+
+#include "apollo/Apollo.h"
+#include "apollo/Region.h"
+#include "apollo/Timer.h"
+#include "mpi.h"
+
+#define TIMER_CALLS  10000000
+#define REGION_CALLS 1000000
+
+static double
+elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+int main()
+{
+    MPI_Init(NULL, NULL);
+
+    Apollo *apollo = Apollo::instance();
+    Apollo::Region *r = new Apollo::Region(1, "timer-bench", 2);
+
+    printf("%-16s %14s %14s\n", "timer", "now() ns", "region ns");
+    for(auto name : { "steady", "monotonic_raw", "tsc" }) {
+        Timer::init( name );
+
+        volatile Timer::tick_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < TIMER_CALLS; i++)
+            sink = sink + Timer::now();
+        double timer_ns = elapsed( start ) * 1e9 / TIMER_CALLS;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < REGION_CALLS; i++) {
+            r->begin();
+            r->setFeature(0);
+            r->getPolicyIndex();
+            r->end();
+        }
+        double region_ns = elapsed( start ) * 1e9 / REGION_CALLS;
+
+        // Timer::name() reports the fallback if the requested backend is
+        // unavailable.
+        printf("%-16s %14.2f %14.2f\n", Timer::name(), timer_ns, region_ns);
+    }
+
+    MPI_Finalize();
+    return 0;
+}